@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# Replay a directory of demos headless, in parallel, and compare the
+# per-tic state hashes against recorded golden traces.
+#
+# Usage: demo-regress.sh [-j jobs] [-r] <doom-binary> <demo-directory>
+#
+# Every <name>.lmp in the directory is played with -timedemo -headless.
+# Extra command line arguments for a demo (its IWAD and PWADs, say
+# "-iwad doom2.wad -file map01.wad") are read from <name>.args if it
+# exists; paths are relative to the demo directory. With -r the golden
+# traces <name>.tichash are (re)recorded, otherwise each demo is checked
+# against its trace and the first desynced tic is reported.
+
+usage() {
+	echo "Usage: $0 [-j jobs] [-r] <doom-binary> <demo-directory>" >&2
+	exit 2
+}
+
+# Internal: play a single demo. Invoked in parallel through xargs.
+if [ "$1" = "--run-one" ] ; then
+	mode="$2"
+	doom="$3"
+	demo="$4"
+	name="${demo%.lmp}"
+	args=""
+	if [ -f "$name.args" ] ; then
+		args="$(cat "$name.args")"
+	fi
+	if [ "$mode" = "record" ] ; then
+		hashopt="-tichashes"
+	elif [ -f "$name.tichash" ] ; then
+		hashopt="-checktichashes"
+	else
+		echo "SKIP $(basename "$name"): no $(basename "$name").tichash"
+		exit 0
+	fi
+	# shellcheck disable=SC2086
+	if output="$(cd "$(dirname "$demo")" && "$doom" -nogui $args \
+	             -timedemo "$(basename "$demo")" -headless \
+	             $hashopt "$(basename "$name").tichash" 2>&1)" ; then
+		echo "PASS $(basename "$name")"
+		exit 0
+	else
+		reason="$(echo "$output" | grep -m 1 "desync")"
+		echo "FAIL $(basename "$name"): ${reason:-$(echo "$output" | tail -n 1)}"
+		exit 1
+	fi
+fi
+
+jobs=""
+mode="check"
+
+while getopts "j:r" opt ; do
+	case "$opt" in
+	j) jobs="$OPTARG" ;;
+	r) mode="record" ;;
+	*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+[ $# -eq 2 ] || usage
+
+case "$1" in
+/*) doom="$1" ;;
+*) doom="$PWD/$1" ;;
+esac
+demodir="$2"
+
+if [ -z "$jobs" ] ; then
+	jobs="$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)"
+fi
+
+results="$(find "$demodir" -maxdepth 1 -name '*.lmp' | sort | \
+           xargs -P "$jobs" -I {} sh "$0" --run-one "$mode" "$doom" {})"
+
+echo "$results"
+
+total="$(echo "$results" | grep -c -e '^PASS' -e '^FAIL')"
+failed="$(echo "$results" | grep -c '^FAIL')"
+echo "$((total - failed)) of $total demos passed"
+
+[ "$failed" -eq 0 ]
@@ -133,6 +133,15 @@ opl_init_result_t OPL_Init(unsigned int port_base)
 
     if (driver_name != NULL)
     {
+#ifndef DISABLE_SDL2MIXER
+        // [AP] The offline render driver is only available by name.
+
+        if (!strcmp(driver_name, opl_render_driver.name))
+        {
+            return InitDriver(&opl_render_driver, port_base);
+        }
+#endif // DISABLE_SDL2MIXER
+
         // Search the list until we find the driver with this name.
 
         for (i=0; drivers[i] != NULL; ++i)
@@ -491,6 +500,15 @@ void OPL_Delay(uint64_t us)
 
     OPL_SetCallback(us, DelayCallback, &delay_data);
 
+#ifndef DISABLE_SDL2MIXER
+    // [AP] Nothing else drives the clock of the offline render driver.
+
+    if (driver == &opl_render_driver)
+    {
+        OPL_Render_AdvanceTime(us);
+    }
+#endif // DISABLE_SDL2MIXER
+
     // Wait until the callback is invoked.
 
     SDL_LockMutex(delay_data.mutex);
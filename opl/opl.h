@@ -149,5 +149,11 @@ void OPL_Delay(uint64_t us);
 
 void OPL_SetPaused(int paused);
 
+// [AP] Generate nsamples stereo 16-bit frames into buffer, invoking any
+// callbacks that fall due.  Only does anything when the "render" driver
+// was selected (OPL_DRIVER=render); it is never chosen automatically.
+
+void OPL_Render(int16_t *buffer, unsigned int nsamples);
+
 #endif
 
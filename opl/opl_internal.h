@@ -65,6 +65,11 @@ extern opl_driver_t opl_openbsd_driver;
 extern opl_driver_t opl_win32_driver;
 #endif
 extern opl_driver_t opl_sdl_driver;
+extern opl_driver_t opl_render_driver; // [AP]
+
+// [AP] Advance the render driver's clock without generating output.
+
+void OPL_Render_AdvanceTime(uint64_t us);
 
 
 #endif /* #ifndef OPL_INTERNAL_H */
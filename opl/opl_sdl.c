@@ -99,6 +99,11 @@ static int sdl_was_initialized = 0;
 static int mixing_freq, mixing_channels;
 static Uint16 mixing_format;
 
+// [AP] If non-zero, no audio device is opened; output is pulled by the
+// caller through OPL_Render() instead (offline rendering).
+
+static int render_only = 0;
+
 static int SDLIsInitialized(void)
 {
     int freq, channels;
@@ -231,7 +236,17 @@ static void OPL_Mix_Callback(int chan, void *stream, int len, void *udata)
 
 static void OPL_SDL_Shutdown(void)
 {
-    Mix_HookMusic(NULL, NULL);
+    if (render_only)
+    {
+        OPL_Queue_Destroy(callback_queue);
+        free(mix_buffer);
+        mix_buffer = NULL;
+        render_only = 0;
+    }
+    else
+    {
+        Mix_HookMusic(NULL, NULL);
+    }
 
     if (sdl_was_initialized)
     {
@@ -292,7 +307,11 @@ static int OPL_SDL_Init(unsigned int port_base)
     // Check if SDL_mixer has been opened already
     // If not, we must initialize it now
 
-    if (!SDLIsInitialized())
+    if (render_only)
+    {
+        sdl_was_initialized = 0;
+    }
+    else if (!SDLIsInitialized())
     {
         if (SDL_Init(SDL_INIT_AUDIO) < 0)
         {
@@ -330,7 +349,16 @@ static int OPL_SDL_Init(unsigned int port_base)
 
     // Get the mixer frequency, format and number of channels.
 
-    Mix_QuerySpec(&mixing_freq, &mixing_format, &mixing_channels);
+    if (render_only)
+    {
+        mixing_freq = opl_sample_rate;
+        mixing_format = AUDIO_S16SYS;
+        mixing_channels = 2;
+    }
+    else
+    {
+        Mix_QuerySpec(&mixing_freq, &mixing_format, &mixing_channels);
+    }
 
     // Only supports AUDIO_S16SYS
 
@@ -358,11 +386,60 @@ static int OPL_SDL_Init(unsigned int port_base)
     // Set postmix that adds the OPL music. This is deliberately done
     // as a postmix and not using Mix_HookMusic() as the latter disables
     // normal SDL_mixer music mixing.
-    Mix_RegisterEffect(MIX_CHANNEL_POST, OPL_Mix_Callback, NULL, NULL);
+    if (!render_only)
+    {
+        Mix_RegisterEffect(MIX_CHANNEL_POST, OPL_Mix_Callback, NULL, NULL);
+    }
 
     return 1;
 }
 
+// [AP] Offline render driver: same emulator, but no audio device.
+
+static int OPL_Render_Init(unsigned int port_base)
+{
+    render_only = 1;
+
+    return OPL_SDL_Init(port_base);
+}
+
+void OPL_Render(int16_t *buffer, unsigned int nsamples)
+{
+    unsigned int chunk;
+
+    if (!render_only)
+    {
+        return;
+    }
+
+    memset(buffer, 0, nsamples * 4);
+
+    // FillBuffer() can only generate up to one second at a time.
+
+    while (nsamples > 0)
+    {
+        chunk = nsamples;
+
+        if (chunk >= mixing_freq)
+        {
+            chunk = mixing_freq - 1;
+        }
+
+        OPL_Mix_Callback(0, buffer, chunk * 4, NULL);
+        buffer += chunk * 2;
+        nsamples -= chunk;
+    }
+}
+
+// There is no audio thread to wait on when rendering offline, so
+// OPL_Delay() advances the clock itself.
+
+void OPL_Render_AdvanceTime(uint64_t us)
+{
+    AdvanceTime((unsigned int) ((us * mixing_freq + OPL_SECOND - 1)
+                                / OPL_SECOND));
+}
+
 static unsigned int OPL_SDL_PortRead(opl_port_t port)
 {
     unsigned int result = 0;
@@ -517,5 +594,20 @@ opl_driver_t opl_sdl_driver =
     OPL_SDL_AdjustCallbacks,
 };
 
+opl_driver_t opl_render_driver =
+{
+    "render",
+    OPL_Render_Init,
+    OPL_SDL_Shutdown,
+    OPL_SDL_PortRead,
+    OPL_SDL_PortWrite,
+    OPL_SDL_SetCallback,
+    OPL_SDL_ClearCallbacks,
+    OPL_SDL_Lock,
+    OPL_SDL_Unlock,
+    OPL_SDL_SetPaused,
+    OPL_SDL_AdjustCallbacks,
+};
+
 
 #endif // DISABLE_SDL2MIXER
@@ -1615,6 +1615,8 @@ void apdoom_remove_save_dir(void)
 		return; // Don't attempt to remove anything that isn't a practice save
 	// We don't support redirecting temp saves, so this shouldn't be able to do anything nasty.
 	std::filesystem::remove_all(ap_save_path);
+	if (ap_settings.saves_removed_callback)
+		ap_settings.saves_removed_callback();
 }
 
 
@@ -2245,10 +2247,129 @@ const char *APDOOM_ReceiveDeath()
 static std::vector<ap_savesettings_t> savedata_cache;
 char memo_buffer[64 + 1];
 
+// save/index.json caches the launcher summary of every save, so that only
+// saves whose apstate.json or memo.txt changed get reparsed. A world's
+// directory is only listed again when its mtime changes (a save was
+// created or deleted).
+#define SAVE_INDEX_VERSION 1
+
+static int64_t save_index_mtime(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	auto mtime = std::filesystem::last_write_time(path, ec);
+	return ec ? 0 : (int64_t)mtime.time_since_epoch().count();
+}
+
+static Json::Value read_save_summary(const std::filesystem::path& save_path)
+{
+	Json::Value summary(Json::objectValue);
+	summary["valid"] = false;
+
+	std::ifstream f(save_path / "apstate.json");
+	if (!f.is_open())
+		return summary; // State json is missing or not openable
+
+	try
+	{
+		Json::Value json;
+		f >> json;
+
+		if (json["launcher_data"].isObject())
+		{
+			summary["victory"] = json["victory"].asBool();
+
+			json = json["launcher_data"];
+			summary["last_timestamp"] = json["_last_timestamp"].asInt64();
+			summary["initial_timestamp"] = json["_initial_timestamp"].asInt64();
+			summary["slot_name"] = json["slot_name"].asString();
+			summary["address"] = json["address"].asString();
+			summary["server_pass"] = json["server_pass"].asString();
+			summary["extra_args"] = json.get("extra_args", "").asString();
+			summary["overrides"] = json.get("overrides", Json::objectValue);
+			summary["valid"] = true;
+		}
+	}
+	catch (...) { summary["valid"] = false; } // Don't include this save game.
+	f.close();
+
+	std::ifstream memo(save_path / "memo.txt");
+	if (memo.is_open())
+	{
+		char buf[64 + 1] = {0};
+		memo.read(buf, 64);
+		summary["memo"] = buf;
+	}
+	return summary;
+}
+
+static void fill_savesettings(ap_savesettings_t& savedata, const Json::Value& summary)
+{
+	savedata.victory = summary["victory"].asBool();
+	savedata.practice_mode = false;
+	savedata.last_timestamp = summary["last_timestamp"].asInt64();
+	savedata.initial_timestamp = summary["initial_timestamp"].asInt64();
+	snprintf(savedata.slot_name, 64 + 1, "%s", summary["slot_name"].asCString());
+	snprintf(savedata.address, 128 + 1, "%s", summary["address"].asCString());
+	snprintf(savedata.password, 128 + 1, "%s", summary["server_pass"].asCString());
+	snprintf(savedata.extra_cmdline, 256 + 1, "%s", summary["extra_args"].asCString());
+
+	const Json::Value& overrides = summary["overrides"];
+	savedata.skill = overrides.get("skill", -1).asInt();
+	savedata.monster_rando = overrides.get("monster_rando", -1).asInt();
+	savedata.item_rando = overrides.get("item_rando", -1).asInt();
+	savedata.music_rando = overrides.get("music_rando", -1).asInt();
+	savedata.flip_levels = overrides.get("flip_levels", -1).asInt();
+	savedata.reset_level = overrides.get("reset_level_on_death", -1).asInt();
+	savedata.no_deathlink = overrides.get("no_deathlink", -1).asInt();
+
+	snprintf(memo_buffer, 64 + 1, "%s", summary.get("memo", "").asCString());
+	for (char *c = memo_buffer; *c; ++c)
+		*c = (*c == '\n' ? ' ' : *c);
+	if (!memo_buffer[0])
+	{
+		time_t save_timestamp = (time_t)savedata.initial_timestamp;
+		strftime(memo_buffer, 64 + 1, "%b %d %Y", localtime(&save_timestamp));
+	}
+
+	snprintf(savedata.description, 64 + 1, "%s: %s", memo_buffer, savedata.slot_name);
+}
+
+// The save index is only a cache, so anything in it may have the wrong
+// type; look members up without letting jsoncpp throw over that.
+static const Json::Value& index_member(const Json::Value& value, const char *key)
+{
+	static const Json::Value null_value;
+	return value.isObject() ? value[key] : null_value;
+}
+
+static bool index_int64(const Json::Value& value, const char *key, int64_t expected)
+{
+	const Json::Value& member = index_member(value, key);
+	return member.isInt64() && member.asInt64() == expected;
+}
+
+// Fills savedata from a save summary. Returns 1 if it describes a usable
+// save, 0 if not, and -1 if the summary is malformed.
+static int use_save_summary(ap_savesettings_t& savedata, const Json::Value& summary)
+{
+	try
+	{
+		if (!summary.isObject() || !summary["valid"].isBool())
+			return -1;
+		if (!summary["valid"].asBool())
+			return 0;
+		fill_savesettings(savedata, summary);
+		return 1;
+	}
+	catch (const Json::Exception&)
+	{
+		return -1;
+	}
+}
+
 const ap_savesettings_t *APDOOM_FindSaves(int *save_count)
 {
 	ap_savesettings_t tmp_savedata;
-	bool insert;
 
 	savedata_cache.clear();
 	savedata_cache.reserve(16);
@@ -2256,6 +2377,24 @@ const ap_savesettings_t *APDOOM_FindSaves(int *save_count)
 	const std::filesystem::path save_dir(std::filesystem::current_path() / "save");
 	if (std::filesystem::is_directory(save_dir))
 	{
+		Json::Value index;
+		try
+		{
+			std::ifstream f(save_dir / "index.json");
+			if (f.is_open())
+				f >> index;
+		}
+		catch (...) {}
+		if (!index_member(index, "version").isInt()
+			|| index["version"].asInt() != SAVE_INDEX_VERSION
+			|| !index["worlds"].isObject())
+			index = Json::Value(Json::objectValue);
+
+		const Json::Value& old_index = index; // const, so lookups don't add members
+		Json::Value new_index(Json::objectValue);
+		new_index["version"] = SAVE_INDEX_VERSION;
+		bool index_dirty = false;
+
 		const ap_worldinfo_t **games_list = ap_list_worlds();
 		for (int i = 0; games_list[i]; ++i)
 		{
@@ -2263,67 +2402,74 @@ const ap_savesettings_t *APDOOM_FindSaves(int *save_count)
 			if (!std::filesystem::is_directory(game_save_dir))
 				continue;
 
-			tmp_savedata.world = games_list[i];
-			for (auto const &entry : std::filesystem::directory_iterator(game_save_dir))
-			{
-				if (!entry.is_directory())
-					continue; // Not a directory?
-
-				std::ifstream f(entry.path() / "apstate.json");
-				if (!f.is_open())
-					continue; // State json is missing or not openable
+			const Json::Value& old_world = index_member(index_member(old_index, "worlds"), games_list[i]->shortname);
+			Json::Value& new_world = new_index["worlds"][games_list[i]->shortname];
+			const int64_t dir_mtime = save_index_mtime(game_save_dir);
+			new_world["mtime"] = (Json::Int64)dir_mtime;
+			new_world["saves"] = Json::Value(Json::objectValue);
 
-				insert = false;
-				try
+			std::vector<std::string> save_names;
+			if (index_int64(old_world, "mtime", dir_mtime) && index_member(old_world, "saves").isObject())
+				save_names = old_world["saves"].getMemberNames();
+			else
+			{
+				index_dirty = true;
+				for (auto const &entry : std::filesystem::directory_iterator(game_save_dir))
 				{
-					Json::Value json;
-					f >> json;
+					if (entry.is_directory())
+						save_names.push_back(entry.path().filename().u8string());
+				}
+			}
 
-					if (json["launcher_data"].isObject())
-					{
-						tmp_savedata.victory = json["victory"].asBool();
-
-						json = json["launcher_data"];
-						tmp_savedata.practice_mode = false;
-						tmp_savedata.last_timestamp = json["_last_timestamp"].asInt64();
-						tmp_savedata.initial_timestamp = json["_initial_timestamp"].asInt64();
-						snprintf(tmp_savedata.slot_name, 64 + 1, "%s", json["slot_name"].asCString());
-						snprintf(tmp_savedata.address, 128 + 1, "%s", json["address"].asCString());
-						snprintf(tmp_savedata.password, 128 + 1, "%s", json["server_pass"].asCString());
-						snprintf(tmp_savedata.extra_cmdline, 256 + 1, "%s", json.get("extra_args", "").asCString());
-
-						json = json.get("overrides", Json::objectValue);
-						tmp_savedata.skill = json.get("skill", -1).asInt();
-						tmp_savedata.monster_rando = json.get("monster_rando", -1).asInt();
-						tmp_savedata.item_rando = json.get("item_rando", -1).asInt();
-						tmp_savedata.music_rando = json.get("music_rando", -1).asInt();
-						tmp_savedata.flip_levels = json.get("flip_levels", -1).asInt();
-						tmp_savedata.reset_level = json.get("reset_level_on_death", -1).asInt();
-						tmp_savedata.no_deathlink = json.get("no_deathlink", -1).asInt();
-
-						insert = true;
-					}
+			tmp_savedata.world = games_list[i];
+			for (const std::string& save_name : save_names)
+			{
+				const std::filesystem::path save_path(game_save_dir / std::filesystem::u8path(save_name));
+				const int64_t state_mtime = save_index_mtime(save_path / "apstate.json");
+				const int64_t memo_mtime = save_index_mtime(save_path / "memo.txt");
+
+				const Json::Value& cached = index_member(index_member(old_world, "saves"), save_name.c_str());
+				Json::Value summary;
+				int usable = -1;
+				if (index_int64(cached, "state_mtime", state_mtime)
+					&& index_int64(cached, "memo_mtime", memo_mtime))
+				{
+					summary = cached;
+					usable = use_save_summary(tmp_savedata, summary);
 				}
-				catch (...) {} // Don't include this save game.
-				f.close();
+				if (usable < 0)
+				{
+					// Not in the index, out of date, or malformed there.
+					index_dirty = true;
+					summary = read_save_summary(save_path);
+					summary["state_mtime"] = (Json::Int64)state_mtime;
+					summary["memo_mtime"] = (Json::Int64)memo_mtime;
+					usable = use_save_summary(tmp_savedata, summary);
+				}
+				new_world["saves"][save_name] = summary;
 
-				if (!insert)
+				if (usable <= 0)
 					continue;
 
-				std::string path_from_cwd = std::filesystem::relative(entry.path()).string();
+				std::string path_from_cwd = (std::filesystem::path("save") / games_list[i]->shortname / std::filesystem::u8path(save_name)).string();
 				snprintf(tmp_savedata.path, 256 + 1, "%s", path_from_cwd.c_str());
 
-				APDOOM_GetSaveMemo(&tmp_savedata);
-				if (!memo_buffer[0])
-				{
-					time_t save_timestamp = (time_t)tmp_savedata.initial_timestamp;
-					strftime(memo_buffer, 64 + 1, "%b %d %Y", localtime(&save_timestamp));
-				}
-
-				snprintf(tmp_savedata.description, 64 + 1, "%s: %s", memo_buffer, tmp_savedata.slot_name);
 				savedata_cache.emplace_back(tmp_savedata);
 			}
 		}
+
+		if (index_dirty)
+		{
+			std::ofstream f(save_dir / "index.json.tmp");
+			if (f.is_open())
+			{
+				f << new_index;
+				f.close();
+
+				std::error_code ec;
+				std::filesystem::rename(save_dir / "index.json.tmp", save_dir / "index.json", ec);
+			}
+		}
 	}
 
 	std::sort(savedata_cache.begin(), savedata_cache.end(),
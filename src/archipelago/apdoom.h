@@ -157,6 +157,7 @@ typedef struct
     void (*message_callback)(const char*, ap_messagefilter_t);
     void (*victory_callback)(void);
     int (*give_item_callback)(int doom_type, int ep, int map);
+    void (*saves_removed_callback)(void); // Optional, saves were deleted
 
     const char* save_dir;
 
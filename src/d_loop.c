@@ -23,12 +23,16 @@
 #include "d_loop.h"
 #include "d_ticcmd.h"
 
+#include "SDL.h"
+
 #include "i_system.h"
+#include "i_thread.h"
 #include "i_timer.h"
 #include "i_video.h"
 
 #include "m_argv.h"
 #include "m_fixed.h"
+#include "m_misc.h"
 
 #include "net_client.h"
 #include "net_gui.h"
@@ -142,6 +146,12 @@ static int GetAdjustedTime(void)
     return (time_ms * TICRATE) / 1000;
 }
 
+// [AP] Input is sampled and ticcmds are built on the main thread. SDL
+// only delivers events to the thread that owns the window, and
+// G_BuildTiccmd reads and resets mouse, key and pending-action state that
+// the menus and the game change without any locking, so this cannot move
+// to an input thread of its own until that state is split out.
+
 static boolean BuildNewTic(void)
 {
     int	gameticdiv;
@@ -676,13 +686,11 @@ static void SinglePlayerClear(ticcmd_set_t *set)
 
 void tick_sticky_msgs(void);
 
-//
-// TryRunTics
-//
+// Decide how many tics to run, waiting for them to become available if
+// necessary. Returns false if there is nothing to run this frame.
 
-void TryRunTics (void)
+static boolean PrepareTics(int *out_counts, int *out_lowtic)
 {
-    int	i;
     int	lowtic;
     int	entertic;
     static int oldentertics;
@@ -738,7 +746,7 @@ void TryRunTics (void)
         // [AM] If we've uncapped the framerate and there are no tics
         //      to run, return early instead of waiting around.
         if (return_early)
-            return;
+            return false;
     }
     else
     {
@@ -753,7 +761,7 @@ void TryRunTics (void)
         // [AM] If we've uncapped the framerate and there are no tics
         //      to run, return early instead of waiting around.
         if (return_early)
-            return;
+            return false;
 
         if (counts < 1)
             counts = 1;
@@ -785,17 +793,40 @@ void TryRunTics (void)
             // forever - give the menu a chance to work.
             if (I_GetTime() / ticdup - entertic >= MAX_NETGAME_STALL_TICS)
             {
-                return;
+                return false;
             }
 
             I_Sleep(1);
         }
     }
 
-    // run the count * ticdup dics
+    *out_counts = counts;
+    *out_lowtic = lowtic;
+
+    return true;
+}
+
+// Run the count * ticdup tics. On the tic thread (async), input is not
+// sampled and the Archipelago client is not polled in between tics (the
+// main thread does that in D_StartTicsAsync()), and the remaining tics are
+// left for the main thread as soon as the game says it can no longer run
+// them off-thread.
+
+static void RunTics(int counts, int lowtic, boolean async)
+{
+    int	i;
+
     while (counts--)
     {
-        apdoom_update();
+        if (async && !loop_interface->CanRunTicAsync())
+        {
+            return;
+        }
+
+        if (!async)
+        {
+            apdoom_update();
+        }
 
         ticcmd_set_t *set;
 
@@ -828,8 +859,145 @@ void TryRunTics (void)
             tick_sticky_msgs();
 	}
 
-	NetUpdate ();	// check for new console commands
+        if (!async)
+        {
+	    NetUpdate ();	// check for new console commands
+        }
+    }
+}
+
+//
+// TryRunTics
+//
+
+void TryRunTics (void)
+{
+    int counts, lowtic;
+
+    if (PrepareTics(&counts, &lowtic))
+    {
+        RunTics(counts, lowtic, false);
+    }
+}
+
+// [AP] Tic thread: runs the tics prepared by D_StartTicsAsync() while
+// the main thread presents the frame it has just rendered. Sounds started
+// by these tics go through the mixer's own lock; the main thread does not
+// touch the sound code until D_FinishTicsAsync() has returned.
+
+static SDL_Thread *tic_thread;
+static SDL_sem *tic_start, *tic_done;
+static int async_counts, async_lowtic;
+static boolean async_running;
+
+// An I_Error() on the tic thread is reported by the main thread from
+// D_FinishTicsAsync(), so that exit functions and message boxes do not
+// run in the middle of SDL_RenderPresent().
+
+static char async_error[512];
+static boolean async_failed;
+
+static void TicThreadError(const char *msg)
+{
+    M_StringCopy(async_error, msg, sizeof(async_error));
+    async_failed = true;
+    SDL_SemPost(tic_done);
+
+    // Wait here for the main thread to exit.
+    for (;;)
+    {
+        SDL_Delay(1000);
+    }
+}
+
+static int TicThread(void *unused)
+{
+    I_SetErrorHandoff(TicThreadError);
+
+    for (;;)
+    {
+        SDL_SemWait(tic_start);
+        RunTics(async_counts, async_lowtic, true);
+        SDL_SemPost(tic_done);
     }
+
+    return 0;
+}
+
+static boolean StartTicThread(void)
+{
+    if (tic_thread != NULL)
+    {
+        return true;
+    }
+
+    if (I_NumWorkerThreads() < 2)
+    {
+        return false;
+    }
+
+    tic_start = SDL_CreateSemaphore(0);
+    tic_done = SDL_CreateSemaphore(0);
+
+    if (tic_start != NULL && tic_done != NULL)
+    {
+        tic_thread = SDL_CreateThread(TicThread, "tics", NULL);
+    }
+
+    return tic_thread != NULL;
+}
+
+void D_StartTicsAsync(void)
+{
+    int counts, lowtic;
+
+    if (!PrepareTics(&counts, &lowtic))
+    {
+        return;
+    }
+
+    if (singletics || net_client_connected
+     || loop_interface->CanRunTicAsync == NULL
+     || !loop_interface->CanRunTicAsync()
+     || !StartTicThread())
+    {
+        RunTics(counts, lowtic, false);
+        return;
+    }
+
+    // Archipelago callbacks may change the game state as a whole, so poll
+    // the client here rather than on the tic thread.
+    apdoom_update();
+
+    if (!loop_interface->CanRunTicAsync())
+    {
+        RunTics(counts, lowtic, false);
+        return;
+    }
+
+    async_counts = counts;
+    async_lowtic = lowtic;
+    async_running = true;
+
+    SDL_SemPost(tic_start);
+}
+
+boolean D_FinishTicsAsync(void)
+{
+    if (!async_running)
+    {
+        return false;
+    }
+
+    SDL_SemWait(tic_done);
+    async_running = false;
+
+    if (async_failed)
+    {
+        I_Error("%s", async_error);
+    }
+
+    return true;
 }
 
 void D_RegisterLoopCallbacks(loop_interface_t *i)
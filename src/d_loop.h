@@ -48,6 +48,11 @@ typedef struct
     // Run the menu (runs independently of the game).
 
     void (*RunMenu)();
+
+    // [AP] Whether the next tic may run on the tic thread while the main
+    // thread presents a frame. May be NULL.
+
+    boolean (*CanRunTicAsync)(void);
 } loop_interface_t;
 
 // Register callback functions for the main loop code to use.
@@ -63,6 +68,12 @@ void D_QuitNetGame (void);
 //? how many ticks to run?
 void TryRunTics (void);
 
+// [AP] Like TryRunTics, but the tics themselves are run on the tic thread
+// if the game allows it. D_FinishTicsAsync waits for them, and returns
+// false if none were started.
+void D_StartTicsAsync(void);
+boolean D_FinishTicsAsync(void);
+
 // Called at start of game loop to initialize timers
 void D_StartGameLoop(void);
 
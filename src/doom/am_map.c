@@ -810,13 +810,13 @@ static void AM_CycleMobj(mobj_t **last_mobj, int *last_count, int flags, int ali
 	if (*last_mobj)
 		th = &(*last_mobj)->thinker;
 	else
-		th = &thinkercap;
+		th = &thinkerclasscap[th_mobj];
 
 	start_th = th;
 
 	do
 	{
-		th = th->next;
+		th = th->cnext;
 		if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 		{
 			mobj_t *mobj;
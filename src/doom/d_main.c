@@ -134,6 +134,7 @@ boolean         main_loop_started = false;
 
 int             show_endoom = 0; // [crispy] disable
 int             show_diskicon = 1;
+int             playsim_thread = 0; // [AP]
 
 
 void D_ConnectNetGame(void);
@@ -186,6 +187,8 @@ boolean D_Display (void)
     boolean			redrawsbar;
 		
     redrawsbar = false;
+
+    Z_NextCacheFrame(); // [AP] what is drawn now is the most recently used
     
     if (crispy->uncapped)
     {
@@ -451,6 +454,11 @@ void D_BindVariables(void)
     M_BindIntVariable("a11y_invul_colormap",    &a11y_invul_colormap);
     M_BindIntVariable("show_endoom",            &show_endoom);
     M_BindIntVariable("show_diskicon",          &show_diskicon);
+    M_BindIntVariable("playsim_thread",         &playsim_thread); // [AP]
+    M_BindIntVariable("savegame_compression",   &savegame_compression); // [AP]
+    M_BindIntVariable("savegame_delta",         &savegame_delta); // [AP]
+    M_BindIntVariable("emulate_intercepts_overrun", &emulate_intercepts_overrun); // [AP]
+    M_BindIntVariable("monster_lod_distance",   &monster_lod_distance); // [AP]
 
     // Multiplayer chat macros
 
@@ -576,7 +584,12 @@ void D_RunFrame()
     // frame syncronous IO operations
     I_StartFrame ();
 
-    TryRunTics (); // will run at least one tic
+    // [AP] with playsim_thread, the tics were already run on the tic
+    // thread while the previous frame was being presented
+    if (!D_FinishTicsAsync ())
+    {
+        TryRunTics (); // will run at least one tic
+    }
 
     if (oldgametic < gametic)
     {
@@ -594,6 +607,13 @@ void D_RunFrame()
 
             wipestart = I_GetTime () - 1;
         } else {
+            // [AP] run the next tics on the tic thread while this frame
+            // is presented
+            if (playsim_thread)
+            {
+                D_StartTicsAsync ();
+            }
+
             // normal update
             I_FinishUpdate ();              // page flip or blit buffer
         }
@@ -604,6 +624,7 @@ void D_RunFrame()
 	// frame has finished rendering
 	if (crispy->post_rendering_hook && !wipe)
 	{
+		D_FinishTicsAsync(); // [AP]
 		crispy->post_rendering_hook();
 		crispy->post_rendering_hook = NULL;
 	}
@@ -629,19 +650,26 @@ void D_DoomLoop (void)
 
     main_loop_started = true;
 
-    static char window_title[260];
-    sprintf(window_title, "%s", gamedescription);
-    I_SetWindowTitle(window_title);
-    I_GraphicsCheckCommandLine();
-    I_SetGrabMouseCallback(D_GrabMouseCallback);
-    I_RegisterWindowIcon(doom_icon_data, doom_icon_w, doom_icon_h);
-    I_InitGraphics();
-    EnableLoadingDisk();
+    // [AP] -headless runs the playsim only
+    if (!headless)
+    {
+        static char window_title[260];
+        sprintf(window_title, "%s", gamedescription);
+        I_SetWindowTitle(window_title);
+        I_GraphicsCheckCommandLine();
+        I_SetGrabMouseCallback(D_GrabMouseCallback);
+        I_RegisterWindowIcon(doom_icon_data, doom_icon_w, doom_icon_h);
+        I_InitGraphics();
+        EnableLoadingDisk();
+    }
 
     TryRunTics();
 
-    V_RestoreBuffer();
-    R_ExecuteSetViewSize();
+    if (!headless)
+    {
+        V_RestoreBuffer();
+        R_ExecuteSetViewSize();
+    }
 
     D_StartGameLoop();
 
@@ -1341,10 +1369,10 @@ static void D_Endoom(void)
     byte *endoom;
 
     // Don't show ENDOOM if we have it disabled, or we're running
-    // in screensaver or control test mode. Only show it once the
-    // game has actually started.
+    // in screensaver, control test or headless mode. Only show it once
+    // the game has actually started.
 
-    if (!show_endoom || !main_loop_started
+    if (!show_endoom || !main_loop_started || headless
      || screensaver_mode || M_CheckParm("-testcontrols") > 0)
     {
         return;
@@ -2444,6 +2472,7 @@ void D_DoomMain (void)
     ap_settings.message_callback = APC_OnMessage;
     ap_settings.give_item_callback = APC_OnGiveItem;
     ap_settings.victory_callback = APC_OnVictory;
+    ap_settings.saves_removed_callback = P_ClearLevelSnapshots; // [AP]
     if (!apdoom_init(&ap_settings))
     {
         if (ap_settings.temp_init_file)
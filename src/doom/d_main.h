@@ -46,6 +46,8 @@ void D_StartTitle (void);
 extern  gameaction_t    gameaction;
 extern boolean advancedemo;
 
+extern int playsim_thread; // [AP]
+
 extern const char *pagename;
 
 #endif
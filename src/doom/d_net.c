@@ -93,11 +93,24 @@ static void RunTic(ticcmd_t *cmds, boolean *ingame)
     G_Ticker ();
 }
 
+// [AP] Only plain in-level tics may overlap with presenting a frame.
+// Anything that loads or changes the level, the screen or the game state
+// as a whole is left for the main thread. So is demo playback, which
+// calls I_Quit() from G_CheckDemoStatus() when the demo ends.
+
+static boolean CanRunTicAsync(void)
+{
+    return playsim_thread && crispy->uncapped
+        && gamestate == GS_LEVEL && gameaction == ga_nothing
+        && !advancedemo && !demoplayback && !timingdemo;
+}
+
 static loop_interface_t doom_loop_interface = {
     D_ProcessEvents,
     G_BuildTiccmd,
     RunTic,
-    M_Ticker
+    M_Ticker,
+    CanRunTicAsync
 };
 
 
@@ -62,6 +62,10 @@ typedef struct thinker_s
     struct thinker_s*	prev;
     struct thinker_s*	next;
     think_t		function;
+
+    // [AP] links in the list of this thinker's class
+    struct thinker_s*	cprev;
+    struct thinker_s*	cnext;
     
 } thinker_t;
 
@@ -147,6 +147,7 @@ extern  boolean	paused;		// Game Pause?
 extern  boolean		viewactive;
 
 extern  boolean		nodrawers;
+extern  boolean		headless; // [AP]
 
 
 extern  boolean         testcontrols;
@@ -191,6 +192,7 @@ extern  boolean	usergame;
 //?
 extern  boolean	demoplayback;
 extern  boolean	demorecording;
+extern  boolean	timingdemo; // [AP]
 
 // Round angleturn in ticcmds to the nearest 256.  This is used when
 // recording Vanilla demos in netgames.
@@ -39,6 +39,7 @@
 #include "i_joystick.h"
 #include "i_system.h"
 #include "i_timer.h"
+#include "i_thread.h"
 #include "i_input.h"
 #include "i_swap.h"
 #include "i_video.h"
@@ -125,6 +126,7 @@ boolean         usergame;               // ok to save / end game
  
 boolean         timingdemo;             // if true, exit with report on completion 
 boolean         nodrawers;              // for comparative timing purposes 
+boolean         headless;               // [AP] -timedemo without window or sound
 int             starttime;          	// for comparative timing purposes  	 
  
 boolean         viewactive; 
@@ -265,6 +267,10 @@ int		bodyqueslot;
  
 int             vanilla_savegame_limit = 1;
 int             vanilla_demo_limit = 1;
+int             savegame_compression = 1; // [AP]
+int             savegame_delta = 0; // [AP]
+int             emulate_intercepts_overrun = 1; // [AP]
+int             monster_lod_distance = 0; // [AP]
 
 // [crispy] store last cmd to track joins
 static ticcmd_t* last_cmd = NULL;
@@ -1561,6 +1567,177 @@ void set_ap_player_states()
 }
 
 
+// [AP] Per-tic state hashes for demo regression testing. During demo
+// playback, -tichashes writes one "<tic> <hash>" line per tic, and
+// -checktichashes compares against such a file and stops at the first
+// tic that differs.
+
+static FILE *tichash_file;
+static boolean tichash_check;
+static int tichash_tic;
+
+static void HashInt (unsigned int *hash, int value)
+{
+    int i;
+
+    // FNV-1a, a byte at a time
+    for (i = 0; i < 4; i++)
+    {
+        *hash ^= (value >> (i * 8)) & 0xff;
+        *hash *= 16777619u;
+    }
+}
+
+static unsigned int G_TicHash (void)
+{
+    unsigned int hash = 2166136261u;
+    thinker_t *th;
+    int nummobjs = 0;
+    int i;
+
+    HashInt(&hash, gamestate);
+    HashInt(&hash, rndindex);
+    HashInt(&hash, prndindex);
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+        if (playeringame[i] && players[i].mo)
+        {
+            HashInt(&hash, players[i].mo->x);
+            HashInt(&hash, players[i].mo->y);
+            HashInt(&hash, players[i].mo->z);
+            HashInt(&hash, players[i].mo->angle);
+            HashInt(&hash, players[i].health);
+        }
+    }
+
+    if (gamestate == GS_LEVEL)
+    {
+        for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
+        {
+            if (th->function.acp1 == (actionf_p1) P_MobjThinker)
+            {
+                nummobjs++;
+            }
+        }
+    }
+
+    HashInt(&hash, nummobjs);
+
+    return hash;
+}
+
+static void G_InitTicHashes (void)
+{
+    int p;
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // While playing back a demo, write a hash of the game state (player
+    // positions, mobj count and random number indices) for every tic
+    // to the given file.
+    //
+
+    p = M_CheckParmWithArgs("-tichashes", 1);
+
+    if (p)
+    {
+        tichash_file = M_fopen(myargv[p + 1], "w");
+
+        if (tichash_file == NULL)
+        {
+            I_Error("G_InitTicHashes: Failed to open %s", myargv[p + 1]);
+        }
+
+        return;
+    }
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // While playing back a demo, compare the game state every tic
+    // against hashes written with -tichashes, and exit with an error at
+    // the first tic that differs.
+    //
+
+    p = M_CheckParmWithArgs("-checktichashes", 1);
+
+    if (p)
+    {
+        tichash_file = M_fopen(myargv[p + 1], "r");
+
+        if (tichash_file == NULL)
+        {
+            I_Error("G_InitTicHashes: Failed to open %s", myargv[p + 1]);
+        }
+
+        tichash_check = true;
+    }
+}
+
+static void G_UpdateTicHashes (void)
+{
+    static boolean initialized = false;
+    unsigned int hash, expected;
+    int tic;
+
+    if (!initialized)
+    {
+        G_InitTicHashes();
+        initialized = true;
+    }
+
+    if (tichash_file == NULL)
+    {
+        return;
+    }
+
+    hash = G_TicHash();
+
+    if (!tichash_check)
+    {
+        fprintf(tichash_file, "%d %08x\n", tichash_tic, hash);
+    }
+    else if (fscanf(tichash_file, "%d %x", &tic, &expected) != 2)
+    {
+        I_Error("Demo desync: first desync at tic %d "
+                "(recorded demo ended before this tic)", tichash_tic);
+    }
+    else if (tic != tichash_tic || hash != expected)
+    {
+        I_Error("Demo desync: first desync at tic %d "
+                "(expected %08x, got %08x)", tichash_tic, expected, hash);
+    }
+
+    ++tichash_tic;
+}
+
+// Called when demo playback ends.
+
+static void G_FinishTicHashes (void)
+{
+    int tic;
+    unsigned int expected;
+
+    if (tichash_file == NULL)
+    {
+        return;
+    }
+
+    if (tichash_check
+     && fscanf(tichash_file, "%d %x", &tic, &expected) == 2)
+    {
+        I_Error("Demo desync: first desync at tic %d "
+                "(demo ended early)", tichash_tic);
+    }
+
+    fclose(tichash_file);
+    tichash_file = NULL;
+}
+
 //
 // G_Ticker
 // Make ticcmd_ts for the players.
@@ -1805,6 +1982,12 @@ void G_Ticker (void)
             TickLevelSelect();
             break;
     }        
+
+    // [AP]
+    if (demoplayback)
+    {
+        G_UpdateTicHashes();
+    }
 } 
  
  
@@ -2730,6 +2913,9 @@ extern mobj_t *just_loaded_hub;
 int savedleveltime = 0; // [crispy] moved here for level time logging
 void G_DoLoadGame (void) 
 { 
+    byte *savebuffer;
+    int savelength;
+
     leveltimesinceload = 0;
     just_loaded_hub = 0;
 	 
@@ -2744,13 +2930,26 @@ void G_DoLoadGame (void)
     }
     gameaction = ga_nothing; 
 	 
-    save_stream = M_fopen(savename, "rb");
-
-    if (save_stream == NULL)
+    // [AP] Levels visited recently are restored straight from memory.
+    if (!P_FindLevelSnapshot(savename, &savebuffer, &savelength))
     {
-        I_Error("Could not load savegame %s", savename);
+        byte *filebuffer;
+
+        I_WaitFileWrites(savename);
+
+        if (!M_FileExists(savename))
+        {
+            I_Error("Could not load savegame %s", savename);
+        }
+
+        savelength = M_ReadFile(savename, &filebuffer);
+        filebuffer = P_UncompressSaveGame(savename, filebuffer, &savelength);
+        savebuffer = P_StoreLevelSnapshot(savename, filebuffer, savelength);
+        Z_Free(filebuffer);
     }
 
+    save_stream = mem_fopen_read(savebuffer, savelength);
+
     // [crispy] read extended savegame data,
     //          first pass: read "savewadfilename"
     P_ReadExtendedSaveGameData(0);
@@ -2764,7 +2963,7 @@ void G_DoLoadGame (void)
             strcasecmp(savewadfilename, W_WadNameForLump(savemaplumpinfo)))
         {
             M_ForceLoadGame();
-            fclose(save_stream);
+            mem_fclose(save_stream);
             return;
         }
         else
@@ -2783,7 +2982,7 @@ void G_DoLoadGame (void)
         // [crispy] indicate game version mismatch
         extern void M_LoadGameVerMismatch ();
         M_LoadGameVerMismatch();
-        fclose(save_stream);
+        mem_fclose(save_stream);
         return;
     }
 
@@ -2810,7 +3009,7 @@ void G_DoLoadGame (void)
     // [crispy] read more extended savegame data
     P_ReadExtendedSaveGameData(1);
 
-    fclose(save_stream);
+    mem_fclose(save_stream);
     
     if (setsizeneeded)
 	R_ExecuteSetViewSize ();
@@ -2887,31 +3086,15 @@ void G_DoSaveGame (void)
         snprintf(filename, 260, "%s/save_MAP%02i.dsg", apdoom_get_save_dir(), gamemap);
 
     char *savegame_file;
-    char *temp_savegame_file;
-    char *recovery_savegame_file;
+    void *savebuffer;
+    size_t savelength;
+    void *writebuffer;
 
-    recovery_savegame_file = NULL;
-    temp_savegame_file = P_TempSaveGameFile();
     savegame_file = filename;//P_SaveGameFile(savegameslot);
 
-    // Open the savegame file for writing.  We write to a temporary file
-    // and then rename it at the end if it was successfully written.
-    // This prevents an existing savegame from being overwritten by
-    // a corrupted one, or if a savegame buffer overrun occurs.
-    save_stream = M_fopen(temp_savegame_file, "wb");
-
-    if (save_stream == NULL)
-    {
-        // Failed to save the game, so we're going to have to abort. But
-        // to be nice, save to somewhere else before we call I_Error().
-        recovery_savegame_file = M_TempFile("recovery.dsg");
-        save_stream = M_fopen(recovery_savegame_file, "wb");
-        if (save_stream == NULL)
-        {
-            I_Error("Failed to open either '%s' or '%s' to write savegame.",
-                    temp_savegame_file, recovery_savegame_file);
-        }
-    }
+    // [AP] The savegame is built in memory, kept in the level snapshot
+    // cache, and then written out in the background.
+    save_stream = mem_fopen_write();
 
     savegame_error = false;
 
@@ -2943,31 +3126,29 @@ void G_DoSaveGame (void)
     // Enforce the same savegame size limit as in Vanilla Doom,
     // except if the vanilla_savegame_limit setting is turned off.
 
-    if (vanilla_savegame_limit && ftell(save_stream) > SAVEGAMESIZE)
+    if (vanilla_savegame_limit && mem_ftell(save_stream) > SAVEGAMESIZE)
     {
         I_Error("Savegame buffer overrun");
     }
     */
 
-    // Finish up, close the savegame file.
+    mem_get_buf(save_stream, &savebuffer, &savelength);
 
-    fclose(save_stream);
+    P_StoreLevelSnapshot(savegame_file, savebuffer, savelength);
 
-    if (recovery_savegame_file != NULL)
-    {
-        // We failed to save to the normal location, but we wrote a
-        // recovery file to the temp directory. Now we can bomb out
-        // with an error.
-        I_Error("Failed to open savegame file '%s' for writing.\n"
-                "But your game has been saved to '%s' for recovery.",
-                temp_savegame_file, recovery_savegame_file);
-    }
+    // The I/O thread writes to a temporary file, syncs it and then
+    // renames it over the old savegame, so an existing savegame is never
+    // replaced by a partial one. If that fails, it saves the game to the
+    // temp directory for recovery instead.
+
+    writebuffer = malloc(savelength);
+    memcpy(writebuffer, savebuffer, savelength);
+    I_WriteFileAsync(savegame_file, writebuffer, savelength,
+                     P_CompressSaveGame);
 
-    // Now rename the temporary savegame file to the actual savegame
-    // file, overwriting the old savegame if there was one there.
+    // Finish up, close the savegame stream.
 
-    M_remove(savegame_file);
-    M_rename(temp_savegame_file, savegame_file);
+    mem_fclose(save_stream);
 
     gameaction = ga_nothing;
     M_StringCopy(savedescription, "", sizeof(savedescription));
@@ -3713,6 +3894,10 @@ void G_DoPlayDemo (void)
     }
     precache = true; 
     starttime = I_GetTime (); 
+    if (headless)
+    {
+        P_StartProfile (); // [AP]
+    }
     demostarttic = gametic; // [crispy] fix revenant internal demo bug
 
     usergame = false; 
@@ -3761,6 +3946,21 @@ void G_TimeDemo (char* name)
 
     nodrawers = M_CheckParm ("-nodraw");
 
+    //!
+    // @category video
+    //
+    // With -timedemo, run the demo without opening a window or starting
+    // sound, and print playsim throughput, the peak thinker count and
+    // per-function timings when it ends.
+    //
+
+    headless = M_ParmExists("-headless");
+
+    if (headless)
+    {
+        nodrawers = true;
+    }
+
     timingdemo = true; 
     singletics = true; 
 
@@ -3923,6 +4123,8 @@ boolean G_CheckDemoStatus (void)
     ticcmd_t* cmd = last_cmd;
     last_cmd = NULL;
 
+    G_FinishTicHashes(); // [AP]
+
     if (timingdemo) 
     { 
         float fps;
@@ -3936,6 +4138,13 @@ boolean G_CheckDemoStatus (void)
         timingdemo = false;
         demoplayback = false;
 
+        // [AP] report and exit normally, there is nobody to see a dialog
+        if (headless)
+        {
+            P_PrintProfile ();
+            I_Quit ();
+        }
+
 	I_Error ("timed %i gametics in %i realtics (%f fps)",
                  gametic, realtics, fps);
     } 
@@ -86,6 +86,10 @@ int G_VanillaVersionCode(void);
 
 extern int vanilla_savegame_limit;
 extern int vanilla_demo_limit;
+extern int savegame_compression; // [AP]
+extern int savegame_delta; // [AP]
+extern int emulate_intercepts_overrun; // [AP]
+extern int monster_lod_distance; // [AP]
 
 extern fixed_t forwardmove[2];
 extern fixed_t sidemove[2];
@@ -103,6 +103,7 @@ static hu_textline_t	w_coordx;
 static hu_textline_t	w_coordy;
 static hu_textline_t	w_coorda;
 static hu_textline_t	w_fps;
+boolean			hu_zonestats; // [AP] "idzone" cheat
 boolean			chat_on;
 static hu_itext_t	w_chat;
 static boolean		always_off = false;
@@ -956,6 +957,82 @@ static void HU_DrawCrosshair (void)
 //  V_DrawHorizLine(0, (screenblocks <= 10) ? (SCREENHEIGHT/2-ST_HEIGHT) : (SCREENHEIGHT/2), SCREENWIDTH, 128);
 }
 
+// [AP] Zone allocator statistics page, toggled with the "idzone" cheat.
+// One text line per row, starting below the message line.
+
+static void HU_DrawZoneLine(int row, const char *str)
+{
+    hu_textline_t line;
+
+    HUlib_initTextLine(&line, HU_MSGX, HU_MSGY + 8 * (row + 2),
+                       hu_font, HU_FONTSTART);
+    while (*str)
+	HUlib_addCharToTextLine(&line, *(str++));
+    HUlib_drawTextLine(&line, false);
+}
+
+static void HU_DrawZoneStats(void)
+{
+    static const struct
+    {
+	int tag;
+	const char *name;
+    } tags[] = {
+	{PU_STATIC,     "STATIC"},
+	{PU_SOUND,      "SOUND"},
+	{PU_MUSIC,      "MUSIC"},
+	{PU_LEVEL,      "LEVEL"},
+	{PU_LEVSPEC,    "LEVSPEC"},
+	{PU_PURGELEVEL, "PURGELEVEL"},
+	{PU_CACHE,      "CACHE"},
+    };
+    zonestats_t stats;
+    char str[HU_MAXLINELENGTH];
+    unsigned int freebytes;
+    int frag = 0;
+    int row = 0;
+    int i;
+
+    Z_GetStats(&stats);
+
+    M_snprintf(str, sizeof(str), "%sZONE %s%d arenas, %u KB",
+               cr_stat2, crstr[CR_GRAY], stats.arenas, stats.zonesize >> 10);
+    HU_DrawZoneLine(row++, str);
+
+    for (i = 0; i < arrlen(tags); i++)
+    {
+	M_snprintf(str, sizeof(str), "%s%-10s %s%u KB", cr_stat2,
+	           tags[i].name, crstr[CR_GRAY], stats.tagbytes[tags[i].tag] >> 10);
+	HU_DrawZoneLine(row++, str);
+    }
+
+    freebytes = stats.tagbytes[PU_FREE];
+    if (freebytes > 0)
+    {
+	frag = 100 - (int) ((100.0 * stats.largestfree) / freebytes);
+    }
+
+    M_snprintf(str, sizeof(str), "%sFREE %s%u KB in %d, largest %u KB",
+               cr_stat2, crstr[CR_GRAY], freebytes >> 10, stats.freeblocks,
+               stats.largestfree >> 10);
+    HU_DrawZoneLine(row++, str);
+
+    M_snprintf(str, sizeof(str), "%sFRAG %s%d%%  %sSLABS %s%u KB",
+               cr_stat2, crstr[CR_GRAY], frag,
+               cr_stat2, crstr[CR_GRAY], stats.slabbytes >> 10);
+    HU_DrawZoneLine(row++, str);
+
+    M_snprintf(str, sizeof(str), "%sPURGED %s%u  %sGROWN %s%d  %sFREED %s%d",
+               cr_stat2, crstr[CR_GRAY], stats.purges,
+               cr_stat2, crstr[CR_GRAY], stats.arenagrows,
+               cr_stat2, crstr[CR_GRAY], stats.arenareleases);
+    HU_DrawZoneLine(row++, str);
+
+    M_snprintf(str, sizeof(str), "%sRELOADED %s%u lumps",
+               cr_stat2, crstr[CR_GRAY], lumpreloads);
+    HU_DrawZoneLine(row++, str);
+}
+
 void HU_Drawer(void)
 {
 
@@ -1035,6 +1112,11 @@ void HU_Drawer(void)
 	HUlib_drawTextLine(&w_fps, false);
     }
 
+    if (hu_zonestats)
+    {
+	HU_DrawZoneStats();
+    }
+
     if (crispy->crosshair == CROSSHAIR_STATIC)
 	HU_DrawCrosshair();
 
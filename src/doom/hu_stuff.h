@@ -70,6 +70,8 @@ extern boolean message_dontfuckwithme;
 
 extern boolean chat_on;
 
+extern boolean hu_zonestats; // [AP]
+
 
 #endif
 
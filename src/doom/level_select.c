@@ -24,12 +24,14 @@
 #include "doomstat.h"
 #include "i_joystick.h"
 #include "i_system.h"
+#include "i_thread.h"
 #include "i_video.h"
 #include "d_main.h"
 #include "d_player.h"
 #include "g_game.h"
 #include "m_misc.h"
 #include "m_controls.h"
+#include "p_saveg.h"
 #include "hu_stuff.h"
 #include "hu_lib.h"
 #include "s_sound.h"
@@ -100,7 +102,12 @@ void play_level(int ep, int lvl)
     else
         snprintf(filename, 260, "%s/save_MAP%02i.dsg", apdoom_get_save_dir(), lvl);
 
-    if (M_FileExists(filename))
+    byte *snapshot;
+    int snapshot_length;
+    boolean cached = P_FindLevelSnapshot(filename, &snapshot, &snapshot_length);
+    if (!cached)
+        I_WaitFileWrites(filename); // [AP] The save may still be on its way to disk
+    if (cached || M_FileExists(filename))
     {
         // We load
         extern char savename[256];
@@ -170,11 +170,13 @@ multiitem_t multiitem_translucency[NUM_TRANSLUCENCY] =
     {TRANSLUCENCY_BOTH, "both"},
 };
 
-multiitem_t multiitem_sndchannels[4] =
+multiitem_t multiitem_sndchannels[5] =
 {
     {8, "8"},
     {16, "16"},
     {32, "32"},
+    {64, "64"}, // [AP] with the internal mixer
+    {128, "128"},
 };
 
 multiitem_t multiitem_widgets[NUM_WIDGETS] =
@@ -247,7 +249,7 @@ void M_CrispyToggleColoredblood(int choice)
     ChangeSettingEnum(&crispy->coloredblood, choice, NUM_COLOREDBLOOD);
 
     // [crispy] switch NOBLOOD flag for Lost Souls
-    for (th = thinkercap.next; th && th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext; th && th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 	{
@@ -41,7 +41,7 @@ extern multiitem_t multiitem_ap_filters[];
 extern multiitem_t multiitem_demotimerdir[];
 extern multiitem_t multiitem_freelook[NUM_FREELOOKS];
 extern multiitem_t multiitem_jump[NUM_JUMPS];
-extern multiitem_t multiitem_sndchannels[4];
+extern multiitem_t multiitem_sndchannels[5];
 extern multiitem_t multiitem_secretmessage[NUM_SECRETMESSAGE];
 extern multiitem_t multiitem_statsformat[NUM_STATSFORMATS];
 extern multiitem_t multiitem_translucency[NUM_TRANSLUCENCY];
@@ -1711,6 +1711,14 @@ static void M_DrawCrispness1(void)
 
 static void M_DrawCrispness2(void)
 {
+    int sndchannels = 0;
+
+    // [AP] index of 8, 16, 32, 64 or 128 channels
+    while ((8 << sndchannels) < snd_channels && sndchannels < arrlen(multiitem_sndchannels) - 1)
+    {
+        sndchannels++;
+    }
+
     M_DrawCrispnessBackground();
 
     M_DrawCrispnessHeader("Crispness 2/4");
@@ -1718,7 +1726,7 @@ static void M_DrawCrispness2(void)
     M_DrawCrispnessSeparator(crispness_sep_audible, "Audible");
     M_DrawCrispnessItem(crispness_soundfull, "Play sounds in full length", crispy->soundfull, true);
     M_DrawCrispnessItem(crispness_soundfix, "Misc. Sound Fixes", crispy->soundfix, true);
-    M_DrawCrispnessMultiItem(crispness_sndchannels, "Sound Channels", multiitem_sndchannels, snd_channels >> 4, snd_sfxdevice != SNDDEVICE_PCSPEAKER);
+    M_DrawCrispnessMultiItem(crispness_sndchannels, "Sound Channels", multiitem_sndchannels, sndchannels, snd_sfxdevice != SNDDEVICE_PCSPEAKER);
     M_DrawCrispnessItem(crispness_soundmono, "Mono SFX", crispy->soundmono, true);
 
     M_DrawCrispnessSeparator(crispness_sep_navigational, "Navigational");
@@ -3836,6 +3844,7 @@ static void M_ConfirmDeleteGameResponse (int key)
 
 		M_StringCopy(name, P_SaveGameFile(itemOn), sizeof(name));
 		remove(name);
+		P_ForgetLevelSnapshot(name); // [AP]
 
 		if (itemOn == quickSaveSlot)
 			quickSaveSlot = -1;
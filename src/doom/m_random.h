@@ -37,6 +37,10 @@ int Crispy_Random (void);
 // Fix randoms for demos.
 void M_ClearRandom (void);
 
+// [AP] Table position of P_Random, for demo state hashes. The one of
+// M_Random, rndindex, is declared in doomstat.h.
+extern int prndindex;
+
 // Defined version of P_Random() - P_Random()
 int P_SubRandom (void);
 int Crispy_SubRandom (void);
@@ -18,14 +18,362 @@
 //	[crispy] Create Blockmap
 //
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "i_swap.h"
 #include "i_system.h"
+#include "i_thread.h"
+#include "m_config.h"
+#include "m_misc.h"
 #include "p_local.h"
+#include "w_wad.h"
 #include "z_zone.h"
 
+// [AP] Cache file header: magic, then word count, origin and size of the
+// blockmap as little endian 32 bit words. The lump itself follows.
+#define BLOCKMAP_MAGIC "APBMAP1"
+#define BLOCKMAP_HEADER_SIZE 28
+
+// [AP] Below this many lines the builder isn't worth splitting up.
+#define BLOCKMAP_PARALLEL_LINES 4096
+
+typedef struct
+{
+    int numlines;
+    int *ends;           // per line: start x, y, deltas and end x, y
+    int width;
+    unsigned int tot;
+    int numranges;
+    int *counts;         // per range, per block: lines, then fill cursor
+    int32_t *lump;       // NULL while counting
+    int count;
+    int minx, miny;
+    char *cachefile;
+} bmapbuild_t;
+
+static char *blockmap_cache_dir = NULL;
+
+// [AP] The build runs on a background job while the rest of the map
+// loads, and is collected by P_FinishBlockMap.
+static bmapbuild_t bmapbuild;
+static background_job_t *bmapbuild_job = NULL;
+
 // [crispy] taken from mbfsrc/P_SETUP.C:547-707, slightly adapted
+// [AP] The walk over each line is unchanged, but the lists are built
+// with a two-pass counting sort over ranges of lines instead of growing
+// a list per block.
+
+static void BlockmapRange(void *data, int range)
+{
+  bmapbuild_t *build = data;
+  int first = (int) ((int64_t) build->numlines * range / build->numranges);
+  int last = (int) ((int64_t) build->numlines * (range + 1) / build->numranges);
+  int *counts = build->counts + (size_t) range * build->tot;
+  int32_t *lump = build->lump;
+  unsigned tot = build->tot;
+  int width = build->width;
+  int i, x, y, adx, ady, bend;
+
+  for (i=first; i < last; i++)
+    {
+      const int *end = &build->ends[i * 6];
+      int dx, dy, diff, b;
+
+      // starting coordinates
+      x = end[0];
+      y = end[1];
+
+      // x-y deltas
+      adx = end[2], dx = adx < 0 ? -1 : 1;
+      ady = end[3], dy = ady < 0 ? -1 : 1;
+
+      // difference in preferring to move across y (>0) instead of x (<0)
+      diff = !adx ? 1 : !ady ? -1 :
+	(((x >> MAPBTOFRAC) << MAPBTOFRAC) +
+	 (dx > 0 ? MAPBLOCKUNITS-1 : 0) - x) * (ady = abs(ady)) * dx -
+	(((y >> MAPBTOFRAC) << MAPBTOFRAC) +
+	 (dy > 0 ? MAPBLOCKUNITS-1 : 0) - y) * (adx = abs(adx)) * dy;
+
+      // starting block, and pointer to its blocklist structure
+      b = (y >> MAPBTOFRAC)*width + (x >> MAPBTOFRAC);
+
+      // ending block
+      bend = (end[5] >> MAPBTOFRAC) * width + (end[4] >> MAPBTOFRAC);
+
+      // delta for pointer when moving across y
+      dy *= width;
+
+      // deltas for diff inside the loop
+      adx <<= MAPBTOFRAC;
+      ady <<= MAPBTOFRAC;
+
+      // Now we simply iterate block-by-block until we reach the end block.
+      while ((unsigned) b < tot)    // failsafe -- should ALWAYS be true
+	{
+	  // [AP] First pass counts, second pass fills each range's slot
+	  // from its end, so that lines come out in descending order.
+	  if (lump)
+	    lump[--counts[b]] = i;
+	  else
+	    counts[b]++;
+
+	  // If we have reached the last block, exit
+	  if (b == bend)
+	    break;
+
+	  // Move in either the x or y direction to the next block
+	  if (diff < 0)
+	    diff += ady, b += dx;
+	  else
+	    diff -= adx, b += dy;
+	}
+    }
+}
+
+// [AP] Lay out the lump from the per-range counts and turn the counts
+// into fill cursors. Higher ranges go first within each block, matching
+// the descending order of the original builder.
+
+static void LayoutBlockmap(bmapbuild_t *build)
+{
+  unsigned tot = build->tot;
+  int numranges = build->numranges;
+  int32_t *lump;
+  int count = tot+6;  // we need at least 1 word per block, plus reserved's
+  int ndx, r;
+  unsigned b;
+
+  for (b = 0; b < tot; b++)
+    {
+      int n = 0;
+
+      for (r = 0; r < numranges; r++)
+	n += build->counts[(size_t) r * tot + b];
+
+      if (n)
+	count += n + 2; // 1 header word + 1 trailer word + blocklist
+    }
+
+  // Allocate blockmap lump with computed count
+  lump = malloc(sizeof(*lump) * count);
+  memset(lump, 0, 4 * sizeof(*lump));
+
+  // Compression of empty blocks is performed by reserving two offset words
+  // at tot and tot+1.
+  ndx = tot + 4;
+  lump[ndx++] = 0;    // Store an empty blockmap list at start
+  lump[ndx++] = -1;   // (Used for compression)
+
+  for (b = 0; b < tot; b++)
+    {
+      int start = ndx + 1;
+
+      for (r = numranges - 1; r >= 0; r--)
+	{
+	  int *c = &build->counts[(size_t) r * tot + b];
+
+	  ndx += *c;
+	  *c = ndx + 1;
+	}
+
+      if (ndx + 1 > start)                        // Non-empty blocklist
+	{
+	  lump[b + 4] = start - 1;                // Store index & header
+	  lump[start - 1] = 0;
+	  ndx++;
+	  lump[ndx++] = -1;                       // Store trailer
+	}
+      else            // Empty blocklist: point to reserved empty blocklist
+	lump[b + 4] = tot + 4;
+    }
+
+  build->lump = lump;
+  build->count = count;
+}
+
+// [AP] Cache of built blockmaps, keyed by the lumps they are built from.
 
-void P_CreateBlockMap(void)
+static char *BlockmapCacheFileName(int lumpnum)
+{
+  char linehash[41];
+
+  M_StringCopy(linehash, W_HashLumpNum(lumpnum + ML_LINEDEFS),
+               sizeof(linehash));
+
+  return M_StringJoin(blockmap_cache_dir, linehash, "-",
+                      W_HashLumpNum(lumpnum + ML_VERTEXES), ".bmap", NULL);
+}
+
+static void PutWord(byte *p, int32_t value)
+{
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+}
+
+static int32_t GetWord(const byte *p)
+{
+  return (int32_t) (p[0] | (p[1] << 8) | (p[2] << 16)
+                    | ((uint32_t) p[3] << 24));
+}
+
+// Returns true and sets blockmaplump if the cache file matches this map.
+
+static boolean ReadBlockmapCache(const char *filename, int minx, int miny)
+{
+  byte header[BLOCKMAP_HEADER_SIZE];
+  int tot = bmapwidth * bmapheight;
+  FILE *fstream;
+  int32_t *lump = NULL;
+  int count, i;
+  boolean result = false;
+
+  fstream = M_fopen(filename, "rb");
+
+  if (fstream == NULL)
+    return false;
+
+  if (fread(header, 1, sizeof(header), fstream) == sizeof(header)
+   && !memcmp(header, BLOCKMAP_MAGIC, strlen(BLOCKMAP_MAGIC))
+   && GetWord(header + 12) == minx && GetWord(header + 16) == miny
+   && GetWord(header + 20) == bmapwidth && GetWord(header + 24) == bmapheight
+   && (count = GetWord(header + 8)) >= tot + 6
+   && M_FileLength(fstream) == sizeof(header) + (long) count * 4)
+    {
+      lump = Z_Malloc(sizeof(*lump) * count, PU_LEVEL, 0);
+
+      if (fread(lump, sizeof(*lump), count, fstream) == count)
+	{
+	  result = true;
+
+	  for (i = 0; i < count; i++)
+	    lump[i] = LONG(lump[i]);
+
+	  // Every offset has to point at the 0 header of a list inside the
+	  // lump, and every list entry has to be a line of this map or the
+	  // -1 terminator, or a damaged file would send the game wandering
+	  // through memory.
+	  for (i = 4; i < tot + 4; i++)
+	    {
+	      if (lump[i] < tot + 4 || lump[i] >= count || lump[lump[i]] != 0)
+		result = false;
+	    }
+
+	  for (i = tot + 4; i < count; i++)
+	    {
+	      if (lump[i] != -1 && (lump[i] < 0 || lump[i] >= numlines))
+		result = false;
+	    }
+
+	  // The last list has to be terminated too.
+	  if (lump[count - 1] != -1)
+	    result = false;
+	}
+    }
+
+  fclose(fstream);
+
+  if (result)
+    blockmaplump = lump;
+  else if (lump != NULL)
+    Z_Free(lump);
+
+  return result;
+}
+
+// Written under a temporary name and renamed into place, so a partial
+// file is never picked up.
+
+static void WriteBlockmapCache(bmapbuild_t *build)
+{
+  byte header[BLOCKMAP_HEADER_SIZE];
+  int32_t *words;
+  char *temppath;
+  FILE *fstream;
+  boolean ok;
+  int i;
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, BLOCKMAP_MAGIC, strlen(BLOCKMAP_MAGIC));
+  PutWord(header + 8, build->count);
+  PutWord(header + 12, build->minx);
+  PutWord(header + 16, build->miny);
+  PutWord(header + 20, build->width);
+  PutWord(header + 24, build->tot / build->width);
+
+  words = malloc(sizeof(*words) * build->count);
+
+  for (i = 0; i < build->count; i++)
+    words[i] = LONG(build->lump[i]);
+
+  temppath = M_StringJoin(build->cachefile, ".tmp", NULL);
+  fstream = M_fopen(temppath, "wb");
+
+  if (fstream != NULL)
+    {
+      ok = fwrite(header, 1, sizeof(header), fstream) == sizeof(header)
+        && fwrite(words, sizeof(*words), build->count, fstream) == build->count;
+
+      ok = (fclose(fstream) == 0) && ok;
+
+      if (!ok || M_rename(temppath, build->cachefile) != 0)
+	M_remove(temppath);
+    }
+
+  free(temppath);
+  free(words);
+}
+
+// Compute blockmap, which is stored as a 2d array of variable-sized lists.
+//
+// Pseudocode:
+//
+// For each linedef:
+//
+//   Map the starting and ending vertices to blocks.
+//
+//   Starting in the starting vertex's block, do:
+//
+//     Add linedef to current block's list.
+//
+//     If current block is the same as the ending vertex's block, exit loop.
+//
+//     Move to an adjacent block by moving towards the ending block in
+//     either the x or y direction, to the block which contains the linedef.
+//
+// [AP] This is done twice, once to count the lines in each block and
+// once to store them, each time split across ranges of lines.
+
+static void BuildBlockmap(background_job_t *job, void *data)
+{
+  bmapbuild_t *build = data;
+
+  build->counts = calloc((size_t) build->numranges * build->tot,
+                         sizeof(*build->counts));
+  build->lump = NULL;
+
+  I_ParallelFor(BlockmapRange, build, build->numranges);
+
+  LayoutBlockmap(build);
+
+  I_ParallelFor(BlockmapRange, build, build->numranges);
+
+  free(build->counts);
+}
+
+// [crispy] copied over from P_LoadBlockMap()
+
+static void SetupBlockLinks(void)
+{
+  int count = sizeof(*blocklinks) * bmapwidth * bmapheight;
+  blocklinks = Z_Malloc(count, PU_LEVEL, 0);
+  memset(blocklinks, 0, count);
+  blockmap = blockmaplump+4;
+}
+
+void P_CreateBlockMap(int lumpnum)
 {
   register int i;
   fixed_t minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
@@ -59,136 +407,71 @@ void P_CreateBlockMap(void)
   bmapwidth  = ((maxx-minx) >> MAPBTOFRAC) + 1;
   bmapheight = ((maxy-miny) >> MAPBTOFRAC) + 1;
 
-  // Compute blockmap, which is stored as a 2d array of variable-sized lists.
-  //
-  // Pseudocode:
-  //
-  // For each linedef:
-  //
-  //   Map the starting and ending vertices to blocks.
-  //
-  //   Starting in the starting vertex's block, do:
-  //
-  //     Add linedef to current block's list, dynamically resizing it.
-  //
-  //     If current block is the same as the ending vertex's block, exit loop.
-  //
-  //     Move to an adjacent block by moving towards the ending block in
-  //     either the x or y direction, to the block which contains the linedef.
+  // [AP] Maps without a usable BLOCKMAP are the big ones, so the result
+  // is kept on disk rather than rebuilt every time the map is loaded.
 
-  {
-    typedef struct { int n, nalloc, *list; } bmap_t;  // blocklist structure
-    unsigned tot = bmapwidth * bmapheight;            // size of blockmap
-    bmap_t *bmap = calloc(sizeof *bmap, tot);         // array of blocklists
-    int x, y, adx, ady, bend;
-
-    for (i=0; i < numlines; i++)
-      {
-	int dx, dy, diff, b;
-
-	// starting coordinates
-	x = (lines[i].v1->x >> FRACBITS) - minx;
-	y = (lines[i].v1->y >> FRACBITS) - miny;
-
-	// x-y deltas
-	adx = lines[i].dx >> FRACBITS, dx = adx < 0 ? -1 : 1;
-	ady = lines[i].dy >> FRACBITS, dy = ady < 0 ? -1 : 1;
-
-	// difference in preferring to move across y (>0) instead of x (<0)
-	diff = !adx ? 1 : !ady ? -1 :
-	  (((x >> MAPBTOFRAC) << MAPBTOFRAC) +
-	   (dx > 0 ? MAPBLOCKUNITS-1 : 0) - x) * (ady = abs(ady)) * dx -
-	  (((y >> MAPBTOFRAC) << MAPBTOFRAC) +
-	   (dy > 0 ? MAPBLOCKUNITS-1 : 0) - y) * (adx = abs(adx)) * dy;
-
-	// starting block, and pointer to its blocklist structure
-	b = (y >> MAPBTOFRAC)*bmapwidth + (x >> MAPBTOFRAC);
-
-	// ending block
-	bend = (((lines[i].v2->y >> FRACBITS) - miny) >> MAPBTOFRAC) *
-	    bmapwidth + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
-
-	// delta for pointer when moving across y
-	dy *= bmapwidth;
-
-	// deltas for diff inside the loop
-	adx <<= MAPBTOFRAC;
-	ady <<= MAPBTOFRAC;
-
-	// Now we simply iterate block-by-block until we reach the end block.
-	while ((unsigned) b < tot)    // failsafe -- should ALWAYS be true
-	  {
-	    // Increase size of allocated list if necessary
-	    if (bmap[b].n >= bmap[b].nalloc)
-	      bmap[b].list = I_Realloc(bmap[b].list,
-				     (bmap[b].nalloc = bmap[b].nalloc ?
-				      bmap[b].nalloc*2 : 8)*sizeof*bmap->list);
-
-	    // Add linedef to end of list
-	    bmap[b].list[bmap[b].n++] = i;
-
-	    // If we have reached the last block, exit
-	    if (b == bend)
-	      break;
-
-	    // Move in either the x or y direction to the next block
-	    if (diff < 0)
-	      diff += ady, b += dx;
-	    else
-	      diff -= adx, b += dy;
-	  }
-      }
-
-    // Compute the total size of the blockmap.
-    //
-    // Compression of empty blocks is performed by reserving two offset words
-    // at tot and tot+1.
-    //
-    // 4 words, unused if this routine is called, are reserved at the start.
+  if (blockmap_cache_dir == NULL)
+    blockmap_cache_dir = M_GetCacheDir("blockmap");
 
-    {
-      int count = tot+6;  // we need at least 1 word per block, plus reserved's
+  bmapbuild.cachefile = BlockmapCacheFileName(lumpnum);
 
-      for (i = 0; i < tot; i++)
-	if (bmap[i].n)
-	  count += bmap[i].n + 2; // 1 header word + 1 trailer word + blocklist
+  if (ReadBlockmapCache(bmapbuild.cachefile, minx, miny))
+  {
+    free(bmapbuild.cachefile);
+    SetupBlockLinks();
+    fprintf(stderr, "+BLOCKMAP cached)\n");
+    return;
+  }
 
-      // Allocate blockmap lump with computed count
-      blockmaplump = Z_Malloc(sizeof(*blockmaplump) * count, PU_LEVEL, 0);
-    }
+  // [AP] The build works from a copy of the line ends, as extended nodes
+  // may move the vertexes while it runs.
 
-    // Now compress the blockmap.
+  bmapbuild.numlines = numlines;
+  bmapbuild.ends = malloc(sizeof(*bmapbuild.ends) * 6 * (numlines + 1));
+
+  for (i=0; i < numlines; i++)
     {
-      int ndx = tot += 4;         // Advance index to start of linedef lists
-      bmap_t *bp = bmap;          // Start of uncompressed blockmap
-
-      blockmaplump[ndx++] = 0;    // Store an empty blockmap list at start
-      blockmaplump[ndx++] = -1;   // (Used for compression)
-
-      for (i = 4; i < tot; i++, bp++)
-	if (bp->n)                                      // Non-empty blocklist
-	  {
-	    blockmaplump[blockmaplump[i] = ndx++] = 0;  // Store index & header
-	    do
-	      blockmaplump[ndx++] = bp->list[--bp->n];  // Copy linedef list
-	    while (bp->n);
-	    blockmaplump[ndx++] = -1;                   // Store trailer
-	    free(bp->list);                             // Free linedef list
-	  }
-	else            // Empty blocklist: point to reserved empty blocklist
-	  blockmaplump[i] = tot;
-
-      free(bmap);    // Free uncompressed blockmap
+      int *end = &bmapbuild.ends[i * 6];
+
+      end[0] = (lines[i].v1->x >> FRACBITS) - minx;
+      end[1] = (lines[i].v1->y >> FRACBITS) - miny;
+      end[2] = lines[i].dx >> FRACBITS;
+      end[3] = lines[i].dy >> FRACBITS;
+      end[4] = (lines[i].v2->x >> FRACBITS) - minx;
+      end[5] = (lines[i].v2->y >> FRACBITS) - miny;
     }
-  }
 
-  // [crispy] copied over from P_LoadBlockMap()
-  {
-    int count = sizeof(*blocklinks) * bmapwidth * bmapheight;
-    blocklinks = Z_Malloc(count, PU_LEVEL, 0);
-    memset(blocklinks, 0, count);
-    blockmap = blockmaplump+4;
-  }
+  bmapbuild.minx = minx;
+  bmapbuild.miny = miny;
+  bmapbuild.width = bmapwidth;
+  bmapbuild.tot = bmapwidth * bmapheight;
+  bmapbuild.numranges = numlines < BLOCKMAP_PARALLEL_LINES ? 1
+                      : I_NumWorkerThreads();
+
+  bmapbuild_job = I_StartBackgroundJob(BuildBlockmap, &bmapbuild);
+}
+
+// [AP] Wait for the blockmap build, if there is one, and move its result
+// into the zone.
+
+void P_FinishBlockMap(void)
+{
+  if (bmapbuild_job == NULL)
+    return;
+
+  I_FinishBackgroundJob(bmapbuild_job);
+  bmapbuild_job = NULL;
+
+  WriteBlockmapCache(&bmapbuild);
+
+  blockmaplump = Z_Malloc(sizeof(*blockmaplump) * bmapbuild.count, PU_LEVEL, 0);
+  memcpy(blockmaplump, bmapbuild.lump, sizeof(*blockmaplump) * bmapbuild.count);
+
+  free(bmapbuild.lump);
+  free(bmapbuild.ends);
+  free(bmapbuild.cachefile);
+
+  SetupBlockLinks();
 
   fprintf(stderr, "+BLOCKMAP)\n");
 }
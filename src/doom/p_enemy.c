@@ -26,6 +26,7 @@
 
 #include "doomdef.h"
 #include "p_local.h"
+#include "p_thingindex.h" // [AP]
 #include "d_pwad.h" // [crispy] kex masterlevels
 #include "ap_basic.h" // [AP] apmeta
 
@@ -581,7 +582,7 @@ void A_KeenDie (mobj_t* mo)
     
     // scan the remaining thinkers
     // to see if all Keens are dead
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ; th != &thinkerclasscap[th_mobj] ; th=th->cnext)
     {
 	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
 	    continue;
@@ -1042,6 +1043,7 @@ void A_SkelMissile (mobj_t* actor)
 
     mo->x += mo->momx;
     mo->y += mo->momy;
+    P_UpdateThingIndex(mo); // [AP] moved without being relinked
     mo->tracer = actor->target;
 }
 
@@ -1531,13 +1533,13 @@ A_PainShootSkull
     // count total number of skull currently on the level
     count = 0;
 
-    currentthinker = thinkercap.next;
-    while (currentthinker != &thinkercap)
+    currentthinker = thinkerclasscap[th_mobj].cnext;
+    while (currentthinker != &thinkerclasscap[th_mobj])
     {
 	if (   (currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
 	    && ((mobj_t *)currentthinker)->type == MT_SKULL)
 	    count++;
-	currentthinker = currentthinker->next;
+	currentthinker = currentthinker->cnext;
     }
 
     // if there are allready 20 skulls on the level,
@@ -1807,7 +1809,7 @@ void A_BossDeath (mobj_t* mo)
     
     // scan the remaining thinkers to see
     // if all bosses are dead
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ; th != &thinkerclasscap[th_mobj] ; th=th->cnext)
     {
 	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
 	    continue;
@@ -1945,9 +1947,9 @@ void A_BrainAwake (mobj_t* mo)
     numbraintargets = 0;
     braintargeton = 0;
 
-    for (thinker = thinkercap.next ;
-	 thinker != &thinkercap ;
-	 thinker = thinker->next)
+    for (thinker = thinkerclasscap[th_mobj].cnext ;
+	 thinker != &thinkerclasscap[th_mobj] ;
+	 thinker = thinker->cnext)
     {
 	if (thinker->function.acp1 != (actionf_p1)P_MobjThinker)
 	    continue;	// not a mobj
@@ -22,6 +22,7 @@
 #include "p_local.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_thread.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -233,6 +234,97 @@ void P_LoadNodes_DeePBSP (int lump)
 }
 
 // [crispy] support maps with compressed or uncompressed ZDBSP nodes
+#ifdef HAVE_LIBZ
+// [AP] Compressed nodes are inflated on a background job, started as soon
+// as the map format is known, so that it overlaps loading the rest of the
+// map. The job only sees the lump data and its own malloc()ed output.
+
+typedef struct
+{
+    int lump;
+    const byte *input;
+    int inlen;
+    byte *output;
+    int outlen;
+    const char *error;
+} nodeinflate_t;
+
+static nodeinflate_t nodeinflate;
+static background_job_t *inflate_job = NULL;
+
+static void InflateNodes(background_job_t *job, void *data)
+{
+    nodeinflate_t *state = data;
+    z_stream zstream;
+    int outlen, err;
+
+    // first estimate for compression rate:
+    // output buffer size == 2.5 * input size
+    outlen = 2.5 * state->inlen;
+    state->output = malloc(outlen);
+
+    // initialize stream state for decompression
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.next_in = (byte *) state->input + 4;
+    zstream.avail_in = state->inlen - 4;
+    zstream.next_out = state->output;
+    zstream.avail_out = outlen;
+
+    if (state->output == NULL || inflateInit(&zstream) != Z_OK)
+    {
+	state->error = " initialization";
+	return;
+    }
+
+    // resize if output buffer runs full
+    while ((err = inflate(&zstream, Z_SYNC_FLUSH)) == Z_OK)
+    {
+	int outlen_old = outlen;
+	byte *newoutput;
+
+	outlen = 2 * outlen_old;
+	newoutput = realloc(state->output, outlen);
+
+	if (newoutput == NULL)
+	    break;
+
+	state->output = newoutput;
+	zstream.next_out = state->output + outlen_old;
+	zstream.avail_out = outlen - outlen_old;
+    }
+
+    state->outlen = zstream.total_out;
+
+    if (inflateEnd(&zstream) != Z_OK)
+	state->error = " shut-down";
+
+    if (err != Z_STREAM_END)
+	state->error = "";
+}
+#endif
+
+void P_StartNodesInflate (int lump)
+{
+#ifdef HAVE_LIBZ
+    if (inflate_job != NULL && nodeinflate.lump == lump)
+	return;
+
+    if (inflate_job != NULL)
+    {
+	I_FinishBackgroundJob(inflate_job);
+	free(nodeinflate.output);
+	W_ReleaseLumpNum(nodeinflate.lump);
+    }
+
+    memset(&nodeinflate, 0, sizeof(nodeinflate));
+    nodeinflate.lump = lump;
+    nodeinflate.input = W_CacheLumpNum(lump, PU_STATIC);
+    nodeinflate.inlen = W_LumpLength(lump);
+
+    inflate_job = I_StartBackgroundJob(InflateNodes, &nodeinflate);
+#endif
+}
+
 // adapted from prboom-plus/src/p_setup.c:1040-1331
 // heavily modified, condensed and simplyfied
 // - removed most paranoid checks, brought in line with Vanilla P_LoadNodes()
@@ -255,63 +347,35 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
     unsigned int numNodes;
     vertex_t *newvertarray = NULL;
 
-    data = W_CacheLumpNum(lump, PU_LEVEL);
-
     // 0. Uncompress nodes lump (or simply skip header)
 
     if (compressed)
     {
 #ifdef HAVE_LIBZ
-	const int len =  W_LumpLength(lump);
-	int outlen, err;
-	z_stream *zstream;
-
-	// first estimate for compression rate:
-	// output buffer size == 2.5 * input size
-	outlen = 2.5 * len;
-	output = Z_Malloc(outlen, PU_STATIC, 0);
-
-	// initialize stream state for decompression
-	zstream = malloc(sizeof(*zstream));
-	memset(zstream, 0, sizeof(*zstream));
-	zstream->next_in = data + 4;
-	zstream->avail_in = len - 4;
-	zstream->next_out = output;
-	zstream->avail_out = outlen;
-
-	if (inflateInit(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression initialization!");
-
-	// resize if output buffer runs full
-	while ((err = inflate(zstream, Z_SYNC_FLUSH)) == Z_OK)
-	{
-	    int outlen_old = outlen;
-	    outlen = 2 * outlen_old;
-	    output = I_Realloc(output, outlen);
-	    zstream->next_out = output + outlen_old;
-	    zstream->avail_out = outlen - outlen_old;
-	}
+	// [AP] usually already started by P_SetupLevel
+	P_StartNodesInflate(lump);
+	I_FinishBackgroundJob(inflate_job);
+	inflate_job = NULL;
 
-	if (err != Z_STREAM_END)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression!");
+	if (nodeinflate.error != NULL)
+	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression%s!",
+	            nodeinflate.error);
 
 	fprintf(stderr, "P_LoadNodes: ZDBSP nodes compression ratio %.3f\n",
-	        (float)zstream->total_out/zstream->total_in);
+	        (float)nodeinflate.outlen/(nodeinflate.inlen - 4));
 
-	data = output;
-
-	if (inflateEnd(zstream) != Z_OK)
-	    I_Error("P_LoadNodes: Error during ZDBSP nodes decompression shut-down!");
+	data = output = nodeinflate.output;
 
 	// release the original data lump
 	W_ReleaseLumpNum(lump);
-	free(zstream);
 #else
 	I_Error("P_LoadNodes: Compressed ZDBSP nodes are not supported!");
 #endif
     }
     else
     {
+	data = W_CacheLumpNum(lump, PU_LEVEL);
+
 	// skip header
 	data += 4;
     }
@@ -486,7 +550,7 @@ void P_LoadNodes_ZDBSP (int lump, boolean compressed)
 
 #ifdef HAVE_LIBZ
     if (compressed && output)
-	Z_Free(output);
+	free(output);
     else
 #endif
     W_ReleaseLumpNum(lump);
@@ -42,7 +42,7 @@ static char *line, *string;
 static void P_WritePackageTarname (const char *key)
 {
 	M_snprintf(line, MAX_LINE_LEN, "%s %s\n", key, PACKAGE_VERSION);
-	fputs(line, save_stream);
+	mem_fputs(line, save_stream);
 }
 
 // maplumpinfo->wad_file->basename
@@ -52,7 +52,7 @@ char *savewadfilename = NULL;
 static void P_WriteWadFileName (const char *key)
 {
 	M_snprintf(line, MAX_LINE_LEN, "%s %s\n", key, W_WadNameForLump(maplumpinfo));
-	fputs(line, save_stream);
+	mem_fputs(line, save_stream);
 }
 
 static void P_ReadWadFileName (const char *key)
@@ -73,6 +73,28 @@ static void P_ReadWadFileName (const char *key)
 	}
 }
 
+// [AP] deltaworld
+
+static void P_WriteDeltaWorld (const char *key)
+{
+	if (savegame_world_is_delta)
+	{
+		M_snprintf(line, MAX_LINE_LEN, "%s %d\n", key, 1);
+		mem_fputs(line, save_stream);
+	}
+}
+
+static void P_ReadDeltaWorld (const char *key)
+{
+	int value;
+
+	if (sscanf(line, "%s %d", string, &value) == 2 &&
+	    !strncmp(string, key, MAX_STRING_LEN))
+	{
+		savegame_world_is_delta = (value != 0);
+	}
+}
+
 // extrakills
 
 static void P_WriteExtraKills (const char *key)
@@ -80,7 +102,7 @@ static void P_WriteExtraKills (const char *key)
 	if (extrakills)
 	{
 		M_snprintf(line, MAX_LINE_LEN, "%s %d\n", key, extrakills);
-		fputs(line, save_stream);
+		mem_fputs(line, save_stream);
 	}
 }
 
@@ -102,7 +124,7 @@ static void P_WriteTotalLevelTimes (const char *key)
 	if (totalleveltimes)
 	{
 		M_snprintf(line, MAX_LINE_LEN, "%s %d\n", key, totalleveltimes);
-		fputs(line, save_stream);
+		mem_fputs(line, save_stream);
 	}
 }
 
@@ -125,7 +147,7 @@ static void P_WriteFireFlicker (const char *key)
 {
 	thinker_t* th;
 
-	for (th = thinkercap.next; th != &thinkercap; th = th->next)
+	for (th = thinkerclasscap[th_light].cnext; th != &thinkerclasscap[th_light]; th = th->cnext)
 	{
 		if (th->function.acp1 == (actionf_p1)T_FireFlicker)
 		{
@@ -137,7 +159,7 @@ static void P_WriteFireFlicker (const char *key)
 			           (int)flick->count,
 			           (int)flick->maxlight,
 			           (int)flick->minlight);
-			fputs(line, save_stream);
+			mem_fputs(line, save_stream);
 		}
 	}
 }
@@ -187,7 +209,7 @@ static void P_WriteSoundTarget (const char *key)
 			           key,
 			           i,
 			           P_ThinkerToIndex((thinker_t *) sector->soundtarget));
-			fputs(line, save_stream);
+			mem_fputs(line, save_stream);
 		}
 	}
 }
@@ -221,7 +243,7 @@ static void P_WriteOldSpecial (const char *key)
 			           key,
 			           i,
 			           sector->oldspecial);
-			fputs(line, save_stream);
+			mem_fputs(line, save_stream);
 		}
 	}
 }
@@ -260,7 +282,7 @@ static void P_WriteButton (const char *key)
 			           (int)button->where,
 			           (int)button->btexture,
 			           (int)button->btimer);
-			fputs(line, save_stream);
+			mem_fputs(line, save_stream);
 		}
 	}
 }
@@ -289,7 +311,7 @@ static void P_WriteBrainTarget (const char *key)
 {
 	thinker_t *th;
 
-	for (th = thinkercap.next; th != &thinkercap; th = th->next)
+	for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
 	{
 		if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 		{
@@ -301,7 +323,7 @@ static void P_WriteBrainTarget (const char *key)
 				           key,
 				           numbraintargets,
 				           braintargeton);
-				fputs(line, save_stream);
+				mem_fputs(line, save_stream);
 
 				// [crispy] return after the first brain spitter is found
 				return;
@@ -342,7 +364,7 @@ static void P_WriteMarkPoints (const char *key)
 		           p[5], p[6], p[7], p[8], p[9],
 		           p[10], p[11], p[12], p[13], p[14],
 		           p[15], p[16], p[17], p[18], p[19]);
-		fputs(line, save_stream);
+		mem_fputs(line, save_stream);
 	}
 }
 
@@ -374,7 +396,7 @@ static void P_WritePlayersLookdir (const char *key)
 		if (playeringame[i] && players[i].lookdir)
 		{
 			M_snprintf(line, MAX_LINE_LEN, "%s %d %d\n", key, i, players[i].lookdir);
-			fputs(line, save_stream);
+			mem_fputs(line, save_stream);
 		}
 	}
 }
@@ -404,7 +426,7 @@ static void P_WriteMusInfo (const char *key)
 		strncpy(orig, lumpinfo[musinfo.items[0]]->name, 8);
 
 		M_snprintf(line, MAX_LINE_LEN, "%s %s %s\n", key, lump, orig);
-		fputs(line, save_stream);
+		mem_fputs(line, save_stream);
 	}
 }
 
@@ -459,6 +481,7 @@ static const extsavegdata_t extsavegdata[] =
 	{"markpoints", P_WriteMarkPoints, P_ReadMarkPoints, 1},
 	{"playerslookdir", P_WritePlayersLookdir, P_ReadPlayersLookdir, 1},
 	{"musinfo", P_WriteMusInfo, P_ReadMusInfo, 0},
+	{"deltaworld", P_WriteDeltaWorld, P_ReadDeltaWorld, 0}, // [AP]
 };
 
 void P_WriteExtendedSaveGameData (void)
@@ -477,7 +500,7 @@ void P_WriteExtendedSaveGameData (void)
 
 static void P_ReadKeyValuePairs (int pass)
 {
-	while (fgets(line, MAX_LINE_LEN, save_stream))
+	while (mem_fgets(line, MAX_LINE_LEN, save_stream))
 	{
 		if (sscanf(line, "%s", string) == 1)
 		{
@@ -519,12 +542,15 @@ void P_ReadExtendedSaveGameData (int pass)
 		return;
 	}
 
-	curpos = ftell(save_stream);
+	curpos = mem_ftell(save_stream);
+
+	// [AP] savegames without the key archive the whole world
+	savegame_world_is_delta = false;
 
 	// [crispy] check which map we would want to load
-	fseek(save_stream, SAVESTRINGSIZE + VERSIONSIZE + 1, SEEK_SET); // [crispy] + 1 for "gameskill"
-	if (fread(&episode, 1, 1, save_stream) == 1 &&
-	    fread(&map, 1, 1, save_stream) == 1)
+	mem_fseek(save_stream, SAVESTRINGSIZE + VERSIONSIZE + 1, MEM_SEEK_SET); // [crispy] + 1 for "gameskill"
+	if (mem_fread(&episode, 1, 1, save_stream) == 1 &&
+	    mem_fread(&map, 1, 1, save_stream) == 1)
 	{
 		lumpnum = P_GetNumForMap ((int) episode, (int) map, false);
 	}
@@ -540,23 +566,23 @@ void P_ReadExtendedSaveGameData (int pass)
 	}
 
 	// [crispy] read key/value pairs past the end of the regular savegame data
-	fseek(save_stream, 0, SEEK_END);
-	endpos = ftell(save_stream);
+	mem_fseek(save_stream, 0, MEM_SEEK_END);
+	endpos = mem_ftell(save_stream);
 
 	for (p = endpos - 1; p > 0; p--)
 	{
 		byte curbyte;
 
-		fseek(save_stream, p, SEEK_SET);
+		mem_fseek(save_stream, p, MEM_SEEK_SET);
 
-		if (fread(&curbyte, 1, 1, save_stream) < 1)
+		if (mem_fread(&curbyte, 1, 1, save_stream) < 1)
 		{
 			break;
 		}
 
 		if (curbyte == SAVEGAME_EOF)
 		{
-			if (!fgets(line, MAX_LINE_LEN, save_stream))
+			if (!mem_fgets(line, MAX_LINE_LEN, save_stream))
 			{
 				continue;
 			}
@@ -574,5 +600,5 @@ void P_ReadExtendedSaveGameData (int pass)
 	free(string);
 
 	// [crispy] back to where we started
-	fseek(save_stream, curpos, SEEK_SET);
+	mem_fseek(save_stream, curpos, MEM_SEEK_SET);
 }
@@ -52,6 +52,9 @@ T_MovePlane
     boolean	flag;
     fixed_t	lastpos;
 	
+    // [AP] sight through this sector may change
+    P_ClearSightMemo();
+
     // [AM] Store old sector heights for interpolation.
     if (sector->oldgametic != gametic)
     {
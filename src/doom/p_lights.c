@@ -73,9 +73,9 @@ void P_SpawnFireFlicker (sector_t*	sector)
 	
     flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
 
+    flick->thinker.function.acp1 = (actionf_p1) T_FireFlicker;
     P_AddThinker (&flick->thinker);
 
-    flick->thinker.function.acp1 = (actionf_p1) T_FireFlicker;
     flick->sector = sector;
     flick->maxlight = sector->lightlevel;
     flick->minlight = P_FindMinSurroundingLight(sector,sector->lightlevel)+16;
@@ -131,9 +131,9 @@ void P_SpawnLightFlash (sector_t*	sector)
 	
     flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
+    flash->thinker.function.acp1 = (actionf_p1) T_LightFlash;
     P_AddThinker (&flash->thinker);
 
-    flash->thinker.function.acp1 = (actionf_p1) T_LightFlash;
     flash->sector = sector;
     flash->maxlight = sector->lightlevel;
 
@@ -191,12 +191,12 @@ P_SpawnStrobeFlash
 	
     flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
 
+    flash->thinker.function.acp1 = (actionf_p1) T_StrobeFlash;
     P_AddThinker (&flash->thinker);
 
     flash->sector = sector;
     flash->darktime = fastOrSlow;
     flash->brighttime = STROBEBRIGHT;
-    flash->thinker.function.acp1 = (actionf_p1) T_StrobeFlash;
     flash->maxlight = sector->lightlevel;
     flash->minlight = P_FindMinSurroundingLight(sector, sector->lightlevel);
 		
@@ -356,12 +356,12 @@ void P_SpawnGlowingLight(sector_t*	sector)
 	
     g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
 
+    g->thinker.function.acp1 = (actionf_p1) T_Glow;
     P_AddThinker(&g->thinker);
 
     g->sector = sector;
     g->minlight = P_FindMinSurroundingLight(sector,sector->lightlevel);
     g->maxlight = sector->lightlevel;
-    g->thinker.function.acp1 = (actionf_p1) T_Glow;
     g->direction = -1;
 
     sector->special = 0;
@@ -68,6 +68,21 @@
 // both the head and tail of the thinker list
 extern	thinker_t	thinkercap;	
 
+// [AP] Every thinker is also linked, in the same relative order, into the
+// list of its class, so that code looking for mobjs (or lights) does not
+// have to walk past everything else. The class is picked from the thinker
+// function when it is added; anything that is not a mobj or a light is a
+// sector mover.
+typedef enum
+{
+    th_mobj,
+    th_mover,
+    th_light,
+    NUMTHINKERCLASSES
+} thclass_t;
+
+extern	thinker_t	thinkerclasscap[NUMTHINKERCLASSES];
+
 
 void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
@@ -233,6 +248,10 @@ boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void	P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+
+// [AP] Forget memoized sight checks. Called whenever a floor or ceiling
+// moves, and for every new level.
+void P_ClearSightMemo (void);
 void 	P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
@@ -281,6 +300,10 @@ extern fixed_t		bmaporgx;
 extern fixed_t		bmaporgy;	// origin of block map
 extern mobj_t**		blocklinks;	// for thing chains
 
+// [AP] p_blockmap.c: build a missing BLOCKMAP in the background
+extern void P_CreateBlockMap (int lumpnum);
+extern void P_FinishBlockMap (void);
+
 // [crispy] factor out map lump name and number finding into a separate function
 extern int P_GetNumForMap (int episode, int map, boolean critical);
 
@@ -30,6 +30,7 @@
 #include "m_argv.h"
 #include "m_misc.h"
 #include "p_local.h"
+#include "p_thingindex.h" // [AP]
 
 #include "s_sound.h"
 
@@ -541,7 +542,8 @@ P_CheckPosition
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+	    // [AP] skip things that are too far away without loading them
+	    if (!P_BlockThingsIteratorNear(bx,by,&tmx,&tmy,&tmthing,PIT_CheckThing))
 		return false;
     
     // check lines
@@ -1541,6 +1543,7 @@ boolean PIT_ChangeSector (mobj_t*	thing)
 	    thing->flags &= ~MF_SOLID;
 	thing->height = 0;
 	thing->radius = 0;
+	P_UpdateThingIndex(thing); // [AP]
 
 	// [crispy] connect giblet object with the crushed monster
 	thing->target = thing;
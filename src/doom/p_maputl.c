@@ -31,7 +31,9 @@
 
 #include "doomdef.h"
 #include "doomstat.h"
+#include "g_game.h" // [AP] emulate_intercepts_overrun
 #include "p_local.h"
+#include "p_thingindex.h" // [AP]
 
 
 // State.
@@ -361,6 +363,9 @@ void P_UnsetThingPosition (mobj_t* thing)
 	
     if ( ! (thing->flags & MF_NOBLOCKMAP) )
     {
+	// [AP] before the chains change
+	P_UnlinkThingIndex(thing);
+
 	// inert things don't need to be in blockmap
 	// unlink from block map
 	if (thing->bnext)
@@ -437,11 +442,15 @@ P_SetThingPosition (mobj_t* thing)
 		(*link)->bprev = thing;
 
 	    *link = thing;
+
+	    P_LinkThingIndex(thing, blocky*bmapwidth+blockx); // [AP]
 	}
 	else
 	{
 	    // thing is off the map
 	    thing->bnext = thing->bprev = NULL;
+
+	    P_LinkThingIndex(thing, -1); // [AP]
 	}
     }
 }
@@ -542,6 +551,14 @@ P_BlockThingsIterator
 static intercept_t*	intercepts; // [crispy] remove INTERCEPTS limit
 intercept_t*	intercept_p;
 
+// [AP] intercepts is used as a stack: each P_PathTraverse call adds its
+// intercepts above those of any traversal still in progress, from this
+// index, and drops them again when it returns.
+static size_t	intercepts_base;
+
+// [AP] number of intercepts added by the current P_PathTraverse call
+#define NUM_INTERCEPTS ((int) (intercept_p - intercepts - intercepts_base))
+
 // [crispy] remove INTERCEPTS limit
 // taken from PrBoom+/src/p_maputl.c:422-433
 static void check_intercept(void)
@@ -622,9 +639,9 @@ PIT_AddLineIntercepts (line_t* ld)
     intercept_p->frac = frac;
     intercept_p->isaline = true;
     intercept_p->d.line = ld;
-    InterceptsOverrun(intercept_p - intercepts, intercept_p);
+    InterceptsOverrun(NUM_INTERCEPTS, intercept_p);
     // [crispy] intercepts overflow guard
-    if (intercept_p - intercepts == MAXINTERCEPTS_ORIGINAL + 1)
+    if (NUM_INTERCEPTS == MAXINTERCEPTS_ORIGINAL + 1)
     {
 	if (crispy->crosshair & CROSSHAIR_INTERCEPT)
 	    return false;
@@ -698,9 +715,9 @@ boolean PIT_AddThingIntercepts (mobj_t* thing)
     intercept_p->frac = frac;
     intercept_p->isaline = false;
     intercept_p->d.thing = thing;
-    InterceptsOverrun(intercept_p - intercepts, intercept_p);
+    InterceptsOverrun(NUM_INTERCEPTS, intercept_p);
     // [crispy] intercepts overflow guard
-    if (intercept_p - intercepts == MAXINTERCEPTS_ORIGINAL + 1)
+    if (NUM_INTERCEPTS == MAXINTERCEPTS_ORIGINAL + 1)
     {
 	if (crispy->crosshair & CROSSHAIR_INTERCEPT)
 	    return false;
@@ -714,6 +731,35 @@ boolean PIT_AddThingIntercepts (mobj_t* thing)
 }
 
 
+//
+// [AP] SortIntercepts
+// Sorts by distance along the trace. Intercepts at the same distance
+// stay in the order they were added, which is the order the search for
+// the closest one used to take them in. As the blocks are stepped
+// through from the start of the trace, they mostly arrive in order
+// already, so there is little for an insertion sort to do.
+//
+static void
+SortIntercepts
+( intercept_t*	in,
+  int		count )
+{
+    intercept_t	key;
+    int		i;
+    int		j;
+
+    for (i = 1; i < count; i++)
+    {
+	key = in[i];
+
+	for (j = i; j > 0 && in[j - 1].frac > key.frac; j--)
+	    in[j] = in[j - 1];
+
+	in[j] = key;
+    }
+}
+
+
 //
 // P_TraverseIntercepts
 // Returns true if the traverser function returns true
@@ -724,46 +770,26 @@ P_TraverseIntercepts
 ( traverser_t	func,
   fixed_t	maxfrac )
 {
-    int			count;
-    fixed_t		dist;
-    intercept_t*	scan;
-    intercept_t*	in;
-	
-    count = intercept_p - intercepts;
-    
-    in = 0;			// shut up compiler warning
-	
-    while (count--)
-    {
-	dist = INT_MAX;
-	for (scan = intercepts ; scan<intercept_p ; scan++)
-	{
-	    if (scan->frac < dist)
-	    {
-		dist = scan->frac;
-		in = scan;
-	    }
-	}
-	
-	if (dist > maxfrac)
-	    return true;	// checked everything in range		
+    const size_t	base = intercepts_base;
+    const int		count = NUM_INTERCEPTS;
+    intercept_t		in;
+    int			i;
+
+    // [AP] sort once, rather than scanning for the closest
+    // intercept before every call to func
+    SortIntercepts(intercepts + base, count);
 
-#if 0  // UNUSED
+    for (i = 0; i < count; i++)
     {
-	// don't check these yet, there may be others inserted
-	in = scan = intercepts;
-	for ( scan = intercepts ; scan<intercept_p ; scan++)
-	    if (scan->frac > maxfrac)
-		*in++ = *scan;
-	intercept_p = in;
-	return false;
-    }
-#endif
+	// [AP] func gets a copy, as it may start another traversal,
+	// which can move intercepts when it grows
+	in = intercepts[base + i];
 
-        if ( !func (in) )
-	    return false;	// don't bother going farther
+	if (in.frac > maxfrac)
+	    return true;	// checked everything in range		
 
-	in->frac = INT_MAX;
+        if ( !func (&in) )
+	    return false;	// don't bother going farther
     }
 	
     return true;		// everything was traversed
@@ -875,6 +901,13 @@ static void InterceptsOverrun(int num_intercepts, intercept_t *intercept)
 {
     int location;
 
+    // [AP] optional, except where it has to match Vanilla Doom
+    if (!emulate_intercepts_overrun
+     && !demoplayback && !demorecording && !netgame)
+    {
+        return;
+    }
+
     if (num_intercepts <= MAXINTERCEPTS_ORIGINAL)
     {
         // No overrun
@@ -904,8 +937,8 @@ static void InterceptsOverrun(int num_intercepts, intercept_t *intercept)
 // Returns true if the traverser function returns true
 // for all lines.
 //
-boolean
-P_PathTraverse
+static boolean
+PathTraverse
 ( fixed_t		x1,
   fixed_t		y1,
   fixed_t		x2,
@@ -937,7 +970,6 @@ P_PathTraverse
     earlyout = (flags & PT_EARLYOUT) != 0;
 		
     validcount++;
-    intercept_p = intercepts;
 	
     if ( ((x1-bmaporgx)&(MAPBLOCKSIZE-1)) == 0)
 	x1 += FRACUNIT;	// don't side exactly on a line
@@ -1044,5 +1076,30 @@ P_PathTraverse
     return P_TraverseIntercepts ( trav, FRACUNIT );
 }
 
+// [AP] Gives PathTraverse its own part of intercepts, above that of any
+// traversal it was started from, so the two don't overwrite each other.
+
+boolean
+P_PathTraverse
+( fixed_t		x1,
+  fixed_t		y1,
+  fixed_t		x2,
+  fixed_t		y2,
+  int			flags,
+  boolean (*trav) (intercept_t *))
+{
+    const size_t	outerbase = intercepts_base;
+    boolean		result;
+
+    intercepts_base = intercept_p - intercepts;
+
+    result = PathTraverse(x1, y1, x2, y2, flags, trav);
+
+    intercept_p = intercepts + intercepts_base;
+    intercepts_base = outerbase;
+
+    return result;
+}
+
 
 
@@ -24,6 +24,8 @@
 
 #include "doomdef.h"
 #include "p_local.h"
+#include "p_reject.h" // [AP] genrejectmatrix
+#include "p_thingindex.h" // [AP]
 #include "sounds.h"
 
 #include "st_stuff.h"
@@ -41,6 +43,7 @@
 
 void G_PlayerReborn (int player);
 void P_SpawnMapThing (mapthing_t*	mthing, int index);
+void A_Look (mobj_t* actor); // [AP] monster LOD
 
 
 //
@@ -552,6 +555,77 @@ static inline void MusInfoThinker (mobj_t *thing)
 	}
 }
 
+//
+// [AP] Monster LOD.
+// Monsters waiting for a player only think on one tic in
+// MONSTER_LOD_INTERVAL when every player is both far away and in a
+// sector the REJECT table says they can't see. A_Look can't find a
+// player by sight then, so all that slows down is their idle animation.
+// Which tic is picked by their spawn spot, to spread the work out, and
+// by nothing that differs from one run to the next. A noise or a hit
+// wakes them, and from then on they think every tic.
+//
+#define MONSTER_LOD_INTERVAL 4
+
+static boolean P_Rejected (mobj_t* t1, mobj_t* t2)
+{
+    int		pnum;
+    int		bytenum;
+    int		bitnum;
+
+    pnum = (t1->subsector->sector - sectors) * numsectors
+         + (t2->subsector->sector - sectors);
+    bytenum = pnum>>3;
+    bitnum = 1 << (pnum&7);
+
+    return (rejectmatrix[bytenum]&bitnum)
+        || (genrejectmatrix && (genrejectmatrix[bytenum]&bitnum));
+}
+
+static boolean P_SkipMonsterTic (mobj_t* mobj)
+{
+    fixed_t	dist;
+    unsigned int	phase;
+    mobj_t*	mo;
+    int		i;
+
+    if (monster_lod_distance <= 0
+     || demoplayback || demorecording || netgame)
+	return false;
+
+    // only monsters idling in a state that looks for players
+    if (mobj->state->action.acp1 != (actionf_p1) A_Look
+     || mobj->tics == -1
+     || mobj->momx || mobj->momy || mobj->momz
+     || mobj->z != mobj->floorz
+     || (mobj->flags & MF_SKULLFLY)
+     || mobj->subsector->sector->soundtarget)
+	return false;
+
+    phase = ((unsigned int) mobj->spawnpoint.x * 31
+           + (unsigned int) mobj->spawnpoint.y) * 2654435761u >> 30;
+
+    if ((leveltime + phase) % MONSTER_LOD_INTERVAL == 0)
+	return false;
+
+    dist = MIN(monster_lod_distance, 32767) << FRACBITS;
+
+    for (i = 0; i < MAXPLAYERS; i++)
+    {
+	mo = players[i].mo;
+
+	if (!playeringame[i] || mo == NULL)
+	    continue;
+
+	if (P_AproxDistance(mo->x - mobj->x, mo->y - mobj->y) < dist
+	 || !P_Rejected(mobj, mo))
+	    return false;
+    }
+
+    return true;
+}
+
+
 //
 // P_MobjThinker
 //
@@ -583,6 +657,10 @@ void P_MobjThinker (mobj_t* mobj)
         mobj->oldangle = mobj->angle;
     }
 
+    // [AP] far away monsters idle at a lower rate
+    if (P_SkipMonsterTic(mobj))
+	return;
+
     // momentum movement
     if (mobj->momx
 	|| mobj->momy
@@ -1228,6 +1306,7 @@ void P_CheckMissileSpawn (mobj_t* th)
     th->x += (th->momx>>1);
     th->y += (th->momy>>1);
     th->z += (th->momz>>1);
+    P_UpdateThingIndex(th); // [AP] moved without being relinked
 
     if (!P_TryMove (th, th->x, th->y))
 	P_ExplodeMissile (th);
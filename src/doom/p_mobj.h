@@ -231,6 +231,7 @@ typedef struct mobj_s
     // Links in blocks (if needed).
     struct mobj_s*	bnext;
     struct mobj_s*	bprev;
+    int			bcell, bindex; // [AP] slot in the thing index
     
     struct subsector_s*	subsector;
 
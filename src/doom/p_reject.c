@@ -0,0 +1,900 @@
+//
+// Copyright(C) 2026 Archipelago Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[AP] Generated REJECT matrix, for maps whose REJECT lump is empty.
+//
+//	Sector B is marked as possibly visible from sector A if some
+//	straight line could pass through a chain of two-sided lines leading
+//	from A to B. Floor and ceiling heights are ignored, since they
+//	change, so the matrix only ever rejects pairs of sectors that
+//	P_CheckSight could never connect anyway.
+//
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crispy.h"
+#include "i_thread.h"
+#include "m_argv.h"
+#include "m_config.h"
+#include "m_misc.h"
+#include "p_local.h"
+#include "p_reject.h"
+#include "r_state.h"
+#include "sha1.h"
+
+// Cache file header: magic, sector count and whether the map turned out
+// to be unsuitable, in which case no matrix follows.
+#define REJECT_MAGIC "APREJ1"
+#define REJECT_HEADER_SIZE 12
+
+// Each portal is lengthened by this many map units at both ends, to
+// cover sight lines that P_CheckSight's fixed point maths lets through
+// right next to a vertex.
+#define PORTAL_MARGIN 8.0
+
+// Limits on the search from a single sector. If either is reached the
+// sector is simply assumed to see everything.
+#define MAX_PORTAL_DEPTH 128
+#define MAX_CLIPS_PER_SECTOR (1 << 18)
+
+// Bounds of the (slope, offset) plane that sight lines are searched in.
+#define SLOPE_LIMIT 1e6
+#define OFFSET_LIMIT 1e12
+
+// Grid used to look for linedefs that cross each other.
+#define GRID_SHIFT 9
+
+typedef struct
+{
+    int x1, y1, x2, y2;     // map units
+    int front, back;        // sector numbers; back is -1 if one-sided
+    boolean portal;         // sight can pass through it
+} rline_t;
+
+typedef struct
+{
+    double m, c;
+} rpoint_t;
+
+typedef struct
+{
+    int sector;             // sector the sight line is now in
+    int next;               // next of its portals to try
+    int portal;             // line crossed to get here
+    rpoint_t *region;       // slopes and offsets that are still possible
+    int numpoints;
+} rframe_t;
+
+typedef struct
+{
+    int numsectors;
+    int numlines;
+    rline_t *lines;
+
+    // Portals leading out of each sector: sectorportals[portalstart[s]]
+    // up to sectorportals[portalstart[s + 1]].
+    int *portalstart;
+    int *sectorportals;
+
+    // Sectors with lines that have them on both sides. Such lines are
+    // often drawn inside another sector, so these see and are seen by
+    // everything.
+    byte *selfref;
+
+    int rowbytes;
+    byte *visible;          // numsectors rows of rowbytes
+    byte *matrix;           // the result, laid out like REJECT
+    boolean unsuitable;
+
+    char *cachefile;
+    background_job_t *job;
+} rejectbuild_t;
+
+byte *genrejectmatrix = NULL;
+
+static rejectbuild_t *pending = NULL;
+static char *reject_cache_dir = NULL;
+
+static void FreeRejectBuild(rejectbuild_t *build)
+{
+    free(build->lines);
+    free(build->portalstart);
+    free(build->sectorportals);
+    free(build->selfref);
+    free(build->visible);
+    free(build->matrix);
+    free(build->cachefile);
+    free(build);
+}
+
+//
+// Map checks.
+//
+// The search assumes that every sector is enclosed by its own lines and
+// that no two linedefs cross, so that a sight line can only get from one
+// sector into another through a line between them. Maps that break this
+// are left alone.
+//
+
+typedef struct
+{
+    int sector, x, y;
+} sidevertex_t;
+
+static int CompareSideVertices(const void *a, const void *b)
+{
+    const sidevertex_t *va = a, *vb = b;
+
+    if (va->sector != vb->sector)
+        return va->sector < vb->sector ? -1 : 1;
+    if (va->x != vb->x)
+        return va->x < vb->x ? -1 : 1;
+    if (va->y != vb->y)
+        return va->y < vb->y ? -1 : 1;
+    return 0;
+}
+
+// Every vertex of a closed sector is touched by an even number of its
+// sides.
+
+static boolean SectorsClosed(rejectbuild_t *build)
+{
+    sidevertex_t *sv;
+    int num = 0;
+    int i, j;
+    boolean result = true;
+
+    sv = malloc(build->numlines * 4 * sizeof(*sv));
+
+    for (i = 0; i < build->numlines; i++)
+    {
+        const rline_t *l = &build->lines[i];
+
+        sv[num].sector = l->front; sv[num].x = l->x1; sv[num++].y = l->y1;
+        sv[num].sector = l->front; sv[num].x = l->x2; sv[num++].y = l->y2;
+
+        if (l->back >= 0)
+        {
+            sv[num].sector = l->back; sv[num].x = l->x1; sv[num++].y = l->y1;
+            sv[num].sector = l->back; sv[num].x = l->x2; sv[num++].y = l->y2;
+        }
+    }
+
+    qsort(sv, num, sizeof(*sv), CompareSideVertices);
+
+    for (i = 0; i < num; i = j)
+    {
+        for (j = i + 1; j < num && !CompareSideVertices(&sv[i], &sv[j]); j++);
+
+        if ((j - i) & 1)
+        {
+            result = false;
+            break;
+        }
+    }
+
+    free(sv);
+
+    return result;
+}
+
+static int64_t Orient(int ax, int ay, int bx, int by, int cx, int cy)
+{
+    int64_t d = (int64_t) (bx - ax) * (cy - ay) - (int64_t) (by - ay) * (cx - ax);
+
+    return (d > 0) - (d < 0);
+}
+
+static boolean SameSectors(const rline_t *a, const rline_t *b)
+{
+    return (a->front == b->front && a->back == b->back)
+        || (a->front == b->back && a->back == b->front);
+}
+
+static boolean LinesCross(const rline_t *a, const rline_t *b)
+{
+    int64_t o1, o2, o3, o4;
+
+    o1 = Orient(a->x1, a->y1, a->x2, a->y2, b->x1, b->y1);
+    o2 = Orient(a->x1, a->y1, a->x2, a->y2, b->x2, b->y2);
+
+    if (o1 == 0 && o2 == 0)
+    {
+        // Collinear: only a problem if they overlap and disagree about
+        // the sectors on either side.
+
+        int amin, amax, bmin, bmax;
+
+        if (a->x1 != a->x2)
+        {
+            amin = MIN(a->x1, a->x2); amax = MAX(a->x1, a->x2);
+            bmin = MIN(b->x1, b->x2); bmax = MAX(b->x1, b->x2);
+        }
+        else
+        {
+            amin = MIN(a->y1, a->y2); amax = MAX(a->y1, a->y2);
+            bmin = MIN(b->y1, b->y2); bmax = MAX(b->y1, b->y2);
+        }
+
+        return amin < bmax && bmin < amax && !SameSectors(a, b);
+    }
+
+    o3 = Orient(b->x1, b->y1, b->x2, b->y2, a->x1, a->y1);
+    o4 = Orient(b->x1, b->y1, b->x2, b->y2, a->x2, a->y2);
+
+    return o1 * o2 < 0 && o3 * o4 < 0;
+}
+
+static boolean NoCrossingLines(rejectbuild_t *build)
+{
+    int minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+    int width, height, numcells;
+    int *cellstart, *celllines, *fill;
+    boolean result = true;
+    int i, j, k, x, y;
+
+    for (i = 0; i < build->numlines; i++)
+    {
+        const rline_t *l = &build->lines[i];
+
+        minx = MIN(minx, MIN(l->x1, l->x2));
+        maxx = MAX(maxx, MAX(l->x1, l->x2));
+        miny = MIN(miny, MIN(l->y1, l->y2));
+        maxy = MAX(maxy, MAX(l->y1, l->y2));
+    }
+
+    width = ((maxx - minx) >> GRID_SHIFT) + 1;
+    height = ((maxy - miny) >> GRID_SHIFT) + 1;
+    numcells = width * height;
+
+    cellstart = calloc(numcells + 1, sizeof(int));
+    fill = malloc(numcells * sizeof(int));
+
+    // Every line goes into each cell its bounding box touches.
+
+    for (k = 0; k < 2; k++)
+    {
+        for (i = 0; i < build->numlines; i++)
+        {
+            const rline_t *l = &build->lines[i];
+            int x0 = (MIN(l->x1, l->x2) - minx) >> GRID_SHIFT;
+            int x1 = (MAX(l->x1, l->x2) - minx) >> GRID_SHIFT;
+            int y0 = (MIN(l->y1, l->y2) - miny) >> GRID_SHIFT;
+            int y1 = (MAX(l->y1, l->y2) - miny) >> GRID_SHIFT;
+
+            for (y = y0; y <= y1; y++)
+            {
+                for (x = x0; x <= x1; x++)
+                {
+                    if (k == 0)
+                        cellstart[y * width + x + 1]++;
+                    else
+                        celllines[fill[y * width + x]++] = i;
+                }
+            }
+        }
+
+        if (k == 0)
+        {
+            for (i = 0; i < numcells; i++)
+            {
+                cellstart[i + 1] += cellstart[i];
+                fill[i] = cellstart[i];
+            }
+
+            celllines = malloc(cellstart[numcells] * sizeof(int));
+        }
+    }
+
+    for (k = 0; k < numcells && result; k++)
+    {
+        for (i = cellstart[k]; i < cellstart[k + 1] && result; i++)
+        {
+            for (j = i + 1; j < cellstart[k + 1]; j++)
+            {
+                if (LinesCross(&build->lines[celllines[i]],
+                               &build->lines[celllines[j]]))
+                {
+                    result = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(celllines);
+    free(fill);
+    free(cellstart);
+
+    return result;
+}
+
+//
+// The search.
+//
+// Sight lines leaving a sector through its portal p are written, in a
+// frame where p lies on the y axis and the sight line heads towards +x,
+// as y = m * x + c. Going through another portal keeps its left end on
+// the left of the line and its right end on the right, which is two
+// half-planes in (m, c). The region of lines that pass through every
+// portal on the way is clipped portal by portal, and the search stops
+// going further once it becomes empty.
+//
+
+typedef struct
+{
+    double ox, oy;          // origin, the middle of the first portal
+    double nx, ny;          // unit normal, the way the sight line goes
+} rframe_axes_t;
+
+// Ends of a portal, lengthened, as seen by a sight line crossing it out
+// of the given sector.
+
+static void PortalEnds(const rline_t *l, int fromsector,
+                       double *lx, double *ly, double *rx, double *ry)
+{
+    double dx, dy, len;
+
+    if (l->front == fromsector)
+    {
+        *lx = l->x1; *ly = l->y1; *rx = l->x2; *ry = l->y2;
+    }
+    else
+    {
+        *lx = l->x2; *ly = l->y2; *rx = l->x1; *ry = l->y1;
+    }
+
+    dx = *lx - *rx;
+    dy = *ly - *ry;
+    len = sqrt(dx * dx + dy * dy);
+
+    if (len > 0)
+    {
+        dx *= PORTAL_MARGIN / len;
+        dy *= PORTAL_MARGIN / len;
+    }
+
+    *lx += dx; *ly += dy;
+    *rx -= dx; *ry -= dy;
+}
+
+// Clip a convex region to a * m + b * c <= d, with a little slack so
+// that rounding never loses a line. Returns the new number of points.
+
+static int ClipRegion(const rpoint_t *in, int n, rpoint_t *out,
+                      double a, double b, double d)
+{
+    double dist[MAX_PORTAL_DEPTH * 2 + 8];
+    int i, j, numout = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        double value = a * in[i].m + b * in[i].c;
+
+        dist[i] = value - d;
+
+        if (fabs(dist[i]) <= 1e-9 * (fabs(a * in[i].m) + fabs(b * in[i].c) + fabs(d)))
+        {
+            dist[i] = 0;
+        }
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        j = (i + 1) % n;
+
+        if (dist[i] <= 0)
+        {
+            out[numout++] = in[i];
+        }
+
+        if ((dist[i] < 0 && dist[j] > 0) || (dist[i] > 0 && dist[j] < 0))
+        {
+            double t = dist[i] / (dist[i] - dist[j]);
+
+            out[numout].m = in[i].m + t * (in[j].m - in[i].m);
+            out[numout].c = in[i].c + t * (in[j].c - in[i].c);
+            numout++;
+        }
+    }
+
+    return numout;
+}
+
+static int ClipToPortal(const rframe_axes_t *axes, const rline_t *l,
+                        int fromsector, const rpoint_t *in, int n,
+                        rpoint_t *out, rpoint_t *scratch)
+{
+    double lx, ly, rx, ry;
+    double lxf, lyf, rxf, ryf;
+
+    PortalEnds(l, fromsector, &lx, &ly, &rx, &ry);
+
+    lx -= axes->ox; ly -= axes->oy;
+    rx -= axes->ox; ry -= axes->oy;
+
+    // The frame's y axis is the normal turned left.
+
+    lxf = lx * axes->nx + ly * axes->ny;
+    lyf = ly * axes->nx - lx * axes->ny;
+    rxf = rx * axes->nx + ry * axes->ny;
+    ryf = ry * axes->nx - rx * axes->ny;
+
+    // Left end on or left of the line: c + m * lx <= ly.
+    // Right end on or right of the line: c + m * rx >= ry.
+
+    n = ClipRegion(in, n, scratch, lxf, 1.0, lyf);
+
+    if (n < 3)
+    {
+        return 0;
+    }
+
+    n = ClipRegion(scratch, n, out, -rxf, -1.0, -ryf);
+
+    return n < 3 ? 0 : n;
+}
+
+static void SetAllVisible(rejectbuild_t *build, byte *row)
+{
+    memset(row, 0xff, build->rowbytes);
+}
+
+static void BuildRejectRow(void *data, int source)
+{
+    rejectbuild_t *build = data;
+    byte *row = build->visible + (size_t) source * build->rowbytes;
+    rframe_t stack[MAX_PORTAL_DEPTH];
+    rpoint_t *points, *scratch;
+    byte *used;
+    int clips = 0;
+    int i;
+
+    if (I_BackgroundJobCancelled(build->job))
+    {
+        return;
+    }
+
+    if (build->selfref[source])
+    {
+        SetAllVisible(build, row);
+        return;
+    }
+
+    row[source >> 3] |= 1 << (source & 7);
+
+    points = malloc(MAX_PORTAL_DEPTH * (MAX_PORTAL_DEPTH * 2 + 8)
+                    * sizeof(rpoint_t));
+    scratch = malloc((MAX_PORTAL_DEPTH * 2 + 8) * sizeof(rpoint_t));
+    used = calloc(build->numlines, 1);
+
+    for (i = build->portalstart[source]; i < build->portalstart[source + 1]; i++)
+    {
+        int first = build->sectorportals[i];
+        const rline_t *l = &build->lines[first];
+        rframe_axes_t axes;
+        double lx, ly, rx, ry, len;
+        int depth;
+
+        // Frame for this first portal.
+
+        PortalEnds(l, source, &lx, &ly, &rx, &ry);
+        axes.ox = (lx + rx) / 2;
+        axes.oy = (ly + ry) / 2;
+        len = sqrt((rx - lx) * (rx - lx) + (ry - ly) * (ry - ly));
+        axes.nx = -(ry - ly) / len;
+        axes.ny = (rx - lx) / len;
+
+        stack[0].region = points;
+        stack[0].region[0].m = -SLOPE_LIMIT; stack[0].region[0].c = -OFFSET_LIMIT;
+        stack[0].region[1].m = SLOPE_LIMIT;  stack[0].region[1].c = -OFFSET_LIMIT;
+        stack[0].region[2].m = SLOPE_LIMIT;  stack[0].region[2].c = OFFSET_LIMIT;
+        stack[0].region[3].m = -SLOPE_LIMIT; stack[0].region[3].c = OFFSET_LIMIT;
+        stack[0].numpoints = ClipToPortal(&axes, l, source, stack[0].region, 4,
+                                          stack[0].region, scratch);
+
+        if (stack[0].numpoints == 0)
+        {
+            continue;
+        }
+
+        stack[0].sector = l->front == source ? l->back : l->front;
+        stack[0].next = build->portalstart[stack[0].sector];
+        stack[0].portal = first;
+        row[stack[0].sector >> 3] |= 1 << (stack[0].sector & 7);
+        used[first] = 1;
+        depth = 0;
+
+        while (depth >= 0)
+        {
+            rframe_t *frame = &stack[depth];
+            rframe_t *child;
+            const rline_t *next;
+            int portal;
+
+            if (frame->next >= build->portalstart[frame->sector + 1])
+            {
+                used[frame->portal] = 0;
+                depth--;
+                continue;
+            }
+
+            portal = build->sectorportals[frame->next++];
+
+            if (used[portal])
+            {
+                continue;
+            }
+
+            if (depth + 1 >= MAX_PORTAL_DEPTH || ++clips > MAX_CLIPS_PER_SECTOR)
+            {
+                SetAllVisible(build, row);
+                goto done;
+            }
+
+            if ((clips & 1023) == 0 && I_BackgroundJobCancelled(build->job))
+            {
+                goto done;
+            }
+
+            next = &build->lines[portal];
+            child = &stack[depth + 1];
+            child->region = frame->region + MAX_PORTAL_DEPTH * 2 + 8;
+            child->numpoints = ClipToPortal(&axes, next, frame->sector,
+                                            frame->region, frame->numpoints,
+                                            child->region, scratch);
+
+            if (child->numpoints == 0)
+            {
+                continue;
+            }
+
+            child->sector = next->front == frame->sector ? next->back : next->front;
+            child->next = build->portalstart[child->sector];
+            child->portal = portal;
+            row[child->sector >> 3] |= 1 << (child->sector & 7);
+            used[portal] = 1;
+            depth++;
+        }
+    }
+
+done:
+    free(used);
+    free(scratch);
+    free(points);
+}
+
+static void MakeMatrix(rejectbuild_t *build)
+{
+    int n = build->numsectors;
+    int a, b;
+
+    build->matrix = calloc(((size_t) n * n + 7) / 8, 1);
+
+    for (a = 0; a < n; a++)
+    {
+        const byte *rowa = build->visible + (size_t) a * build->rowbytes;
+
+        for (b = 0; b < n; b++)
+        {
+            const byte *rowb = build->visible + (size_t) b * build->rowbytes;
+            size_t pnum = (size_t) a * n + b;
+
+            // Sight lines work both ways, so either search will do.
+
+            if (!(rowa[b >> 3] & (1 << (b & 7)))
+             && !(rowb[a >> 3] & (1 << (a & 7))))
+            {
+                build->matrix[pnum >> 3] |= 1 << (pnum & 7);
+            }
+        }
+    }
+}
+
+// Written under a temporary name and renamed into place, so a partial
+// file is never picked up.
+
+static void WriteRejectCache(rejectbuild_t *build)
+{
+    byte header[REJECT_HEADER_SIZE];
+    char *temppath;
+    FILE *fstream;
+    boolean ok;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, REJECT_MAGIC, strlen(REJECT_MAGIC));
+    header[7] = build->unsuitable;
+    header[8] = build->numsectors & 0xff;
+    header[9] = (build->numsectors >> 8) & 0xff;
+    header[10] = (build->numsectors >> 16) & 0xff;
+    header[11] = (build->numsectors >> 24) & 0xff;
+
+    temppath = M_StringJoin(build->cachefile, ".tmp", NULL);
+    fstream = M_fopen(temppath, "wb");
+
+    if (fstream != NULL)
+    {
+        ok = fwrite(header, 1, sizeof(header), fstream) == sizeof(header);
+
+        if (ok && !build->unsuitable)
+        {
+            size_t len = ((size_t) build->numsectors * build->numsectors + 7) / 8;
+            ok = fwrite(build->matrix, 1, len, fstream) == len;
+        }
+
+        ok = (fclose(fstream) == 0) && ok;
+
+        if (!ok || M_rename(temppath, build->cachefile) != 0)
+        {
+            M_remove(temppath);
+        }
+    }
+
+    free(temppath);
+}
+
+static void BuildReject(background_job_t *job, void *data)
+{
+    rejectbuild_t *build = data;
+
+    build->job = job;
+
+    if (!SectorsClosed(build) || !NoCrossingLines(build))
+    {
+        build->unsuitable = true;
+        WriteRejectCache(build);
+        return;
+    }
+
+    build->rowbytes = (build->numsectors + 7) / 8;
+    build->visible = calloc((size_t) build->numsectors * build->rowbytes, 1);
+
+    I_ParallelFor(BuildRejectRow, build, build->numsectors);
+
+    if (I_BackgroundJobCancelled(job))
+    {
+        return;
+    }
+
+    MakeMatrix(build);
+    WriteRejectCache(build);
+}
+
+//
+// Level setup.
+//
+
+// Returns true if the cache settled things, one way or the other.
+
+static boolean ReadRejectCache(rejectbuild_t *build)
+{
+    byte header[REJECT_HEADER_SIZE];
+    size_t len;
+    FILE *fstream;
+    boolean result = false;
+
+    fstream = M_fopen(build->cachefile, "rb");
+
+    if (fstream == NULL)
+    {
+        return false;
+    }
+
+    len = ((size_t) build->numsectors * build->numsectors + 7) / 8;
+
+    if (fread(header, 1, sizeof(header), fstream) == sizeof(header)
+     && !memcmp(header, REJECT_MAGIC, strlen(REJECT_MAGIC))
+     && (header[8] | (header[9] << 8) | (header[10] << 16)
+         | ((unsigned int) header[11] << 24)) == build->numsectors)
+    {
+        if (header[7])
+        {
+            result = true;
+        }
+        else
+        {
+            genrejectmatrix = malloc(len);
+
+            if (fread(genrejectmatrix, 1, len, fstream) == len)
+            {
+                result = true;
+            }
+            else
+            {
+                free(genrejectmatrix);
+                genrejectmatrix = NULL;
+            }
+        }
+    }
+
+    fclose(fstream);
+
+    return result;
+}
+
+static char *RejectCacheFileName(rejectbuild_t *build)
+{
+    sha1_context_t context;
+    sha1_digest_t hash;
+    char hashstr[sizeof(sha1_digest_t) * 2 + 1];
+    int i;
+
+    SHA1_Init(&context);
+    SHA1_UpdateInt32(&context, build->numsectors);
+
+    for (i = 0; i < build->numlines; i++)
+    {
+        const rline_t *l = &build->lines[i];
+
+        SHA1_UpdateInt32(&context, l->x1);
+        SHA1_UpdateInt32(&context, l->y1);
+        SHA1_UpdateInt32(&context, l->x2);
+        SHA1_UpdateInt32(&context, l->y2);
+        SHA1_UpdateInt32(&context, l->front);
+        SHA1_UpdateInt32(&context, l->back);
+        SHA1_UpdateInt32(&context, l->portal);
+    }
+
+    SHA1_Final(hash, &context);
+
+    for (i = 0; i < sizeof(sha1_digest_t); ++i)
+    {
+        M_snprintf(hashstr + i * 2, sizeof(hashstr) - i * 2,
+                   "%02x", hash[i]);
+    }
+
+    return M_StringJoin(reject_cache_dir, hashstr, ".rej", NULL);
+}
+
+// Copy what the search needs out of the level, so that the level can be
+// freed while it runs.
+
+static rejectbuild_t *SnapshotLevel(void)
+{
+    rejectbuild_t *build;
+    int *fill;
+    int i;
+
+    build = calloc(1, sizeof(*build));
+    build->numsectors = numsectors;
+    build->numlines = numlines;
+    build->lines = malloc(numlines * sizeof(rline_t));
+    build->portalstart = calloc(numsectors + 1, sizeof(int));
+    build->selfref = calloc(numsectors, 1);
+
+    for (i = 0; i < numlines; i++)
+    {
+        const line_t *ld = &lines[i];
+        rline_t *l = &build->lines[i];
+
+        l->x1 = ld->v1->x >> FRACBITS;
+        l->y1 = ld->v1->y >> FRACBITS;
+        l->x2 = ld->v2->x >> FRACBITS;
+        l->y2 = ld->v2->y >> FRACBITS;
+        l->front = ld->frontsector - sectors;
+        l->back = ld->backsector ? ld->backsector - sectors : -1;
+
+        // Same test as P_CrossSubsector. A line with the same sector on
+        // both sides doesn't lead anywhere new.
+
+        l->portal = ld->backsector != NULL && (ld->flags & ML_TWOSIDED)
+                 && l->front != l->back
+                 && (l->x1 != l->x2 || l->y1 != l->y2);
+
+        if (l->front == l->back)
+        {
+            build->selfref[l->front] = 1;
+        }
+
+        if (l->portal)
+        {
+            build->portalstart[l->front + 1]++;
+            build->portalstart[l->back + 1]++;
+        }
+    }
+
+    for (i = 0; i < numsectors; i++)
+    {
+        build->portalstart[i + 1] += build->portalstart[i];
+    }
+
+    build->sectorportals = malloc((build->portalstart[numsectors] + 1) * sizeof(int));
+    fill = malloc(numsectors * sizeof(int));
+    memcpy(fill, build->portalstart, numsectors * sizeof(int));
+
+    for (i = 0; i < numlines; i++)
+    {
+        const rline_t *l = &build->lines[i];
+
+        if (l->portal)
+        {
+            build->sectorportals[fill[l->front]++] = i;
+            build->sectorportals[fill[l->back]++] = i;
+        }
+    }
+
+    free(fill);
+
+    return build;
+}
+
+void P_FreeGeneratedReject(void)
+{
+    if (pending != NULL)
+    {
+        I_CancelBackgroundJob(pending->job);
+        I_FinishBackgroundJob(pending->job);
+        FreeRejectBuild(pending);
+        pending = NULL;
+    }
+
+    free(genrejectmatrix);
+    genrejectmatrix = NULL;
+}
+
+void P_GenerateReject(void)
+{
+    rejectbuild_t *build;
+
+    P_FreeGeneratedReject();
+
+    //!
+    // @category mod
+    //
+    // Don't generate a REJECT matrix for maps that come without a
+    // useful REJECT lump.
+    //
+
+    if (M_ParmExists("-nogenreject") || numlines == 0 || numsectors == 0)
+    {
+        return;
+    }
+
+    if (reject_cache_dir == NULL)
+    {
+        reject_cache_dir = M_GetCacheDir("reject");
+    }
+
+    build = SnapshotLevel();
+    build->cachefile = RejectCacheFileName(build);
+
+    if (ReadRejectCache(build))
+    {
+        FreeRejectBuild(build);
+        return;
+    }
+
+    pending = build;
+    build->job = I_StartBackgroundJob(BuildReject, build);
+}
+
+void P_UpdateGeneratedReject(void)
+{
+    if (pending == NULL || !I_BackgroundJobDone(pending->job))
+    {
+        return;
+    }
+
+    I_FinishBackgroundJob(pending->job);
+
+    genrejectmatrix = pending->matrix;
+    pending->matrix = NULL;
+
+    FreeRejectBuild(pending);
+    pending = NULL;
+}
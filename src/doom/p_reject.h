@@ -0,0 +1,37 @@
+//
+// Copyright(C) 2026 Archipelago Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[AP] Generated REJECT matrix.
+//
+
+#ifndef __P_REJECT__
+#define __P_REJECT__
+
+#include "doomtype.h"
+
+// Same layout as rejectmatrix; NULL until it has been generated or read
+// from the cache, or if the map is not suitable.
+extern byte *genrejectmatrix;
+
+// Start generating the matrix for the level just loaded, on a background
+// thread, unless it is already in the cache.
+void P_GenerateReject(void);
+
+// Pick up the matrix once the background thread is done. Called every tic.
+void P_UpdateGeneratedReject(void);
+
+// Drop the matrix, stopping its generation if necessary.
+void P_FreeGeneratedReject(void);
+
+#endif
@@ -19,6 +19,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include "dstrings.h"
 #include "deh_main.h"
@@ -36,7 +43,7 @@
 
 #include "apdoom.h"
 
-FILE *save_stream;
+MEMFILE *save_stream;
 int savegamelength;
 boolean savegame_error;
 static int restoretargets_fail;
@@ -80,13 +87,236 @@ char *P_SaveGameFile(int slot)
     return filename;
 }
 
+// [AP] Level snapshot cache, least recently used entry is replaced first.
+
+#define NUM_LEVEL_SNAPSHOTS 8
+
+typedef struct
+{
+    char *filename;
+    byte *data;
+    int length;
+    unsigned int lastuse;
+} level_snapshot_t;
+
+static level_snapshot_t level_snapshots[NUM_LEVEL_SNAPSHOTS];
+static unsigned int level_snapshot_clock;
+
+static level_snapshot_t *FindSnapshot(const char *filename)
+{
+    int i;
+
+    for (i = 0; i < NUM_LEVEL_SNAPSHOTS; ++i)
+    {
+        if (level_snapshots[i].filename != NULL
+         && !strcmp(level_snapshots[i].filename, filename))
+        {
+            return &level_snapshots[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void FreeSnapshot(level_snapshot_t *snapshot)
+{
+    free(snapshot->filename);
+    free(snapshot->data);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+byte *P_StoreLevelSnapshot(const char *filename, const byte *data, int length)
+{
+    level_snapshot_t *snapshot;
+    int i;
+
+    snapshot = FindSnapshot(filename);
+
+    if (snapshot == NULL)
+    {
+        snapshot = &level_snapshots[0];
+
+        for (i = 1; i < NUM_LEVEL_SNAPSHOTS; ++i)
+        {
+            if (level_snapshots[i].lastuse < snapshot->lastuse)
+            {
+                snapshot = &level_snapshots[i];
+            }
+        }
+
+        FreeSnapshot(snapshot);
+        snapshot->filename = M_StringDuplicate(filename);
+    }
+
+    snapshot->data = I_Realloc(snapshot->data, length);
+    memcpy(snapshot->data, data, length);
+    snapshot->length = length;
+    snapshot->lastuse = ++level_snapshot_clock;
+
+    return snapshot->data;
+}
+
+boolean P_FindLevelSnapshot(const char *filename, byte **data, int *length)
+{
+    level_snapshot_t *snapshot;
+
+    snapshot = FindSnapshot(filename);
+
+    if (snapshot == NULL)
+    {
+        return false;
+    }
+
+    snapshot->lastuse = ++level_snapshot_clock;
+    *data = snapshot->data;
+    *length = snapshot->length;
+
+    return true;
+}
+
+void P_ForgetLevelSnapshot(const char *filename)
+{
+    level_snapshot_t *snapshot;
+
+    snapshot = FindSnapshot(filename);
+
+    if (snapshot != NULL)
+    {
+        FreeSnapshot(snapshot);
+    }
+}
+
+void P_ClearLevelSnapshots(void)
+{
+    int i;
+
+    for (i = 0; i < NUM_LEVEL_SNAPSHOTS; ++i)
+    {
+        FreeSnapshot(&level_snapshots[i]);
+    }
+}
+
+// [AP] Compressed savegames start with this magic and the uncompressed
+// length, followed by a zlib stream.  Regular savegames begin with the
+// description string, so the two can't be confused.
+
+#define SAVEGAME_Z_MAGIC  "DSGZ"
+#define SAVEGAME_Z_HEADER 8
+
+// Refuse to allocate more than this for a savegame read from disk.
+
+#define SAVEGAME_Z_MAXLEN (64 * 1024 * 1024)
+
+void *P_CompressSaveGame(void *data, int *length)
+{
+#ifdef HAVE_LIBZ
+    byte *result;
+    uLongf result_len;
+
+    if (!savegame_compression)
+    {
+        return data;
+    }
+
+    result_len = compressBound(*length);
+    result = malloc(SAVEGAME_Z_HEADER + result_len);
+
+    if (result == NULL
+     || compress2(result + SAVEGAME_Z_HEADER, &result_len,
+                  data, *length, Z_BEST_SPEED) != Z_OK)
+    {
+        // Not fatal, just write it uncompressed.
+        free(result);
+        return data;
+    }
+
+    memcpy(result, SAVEGAME_Z_MAGIC, 4);
+    result[4] = *length & 0xff;
+    result[5] = (*length >> 8) & 0xff;
+    result[6] = (*length >> 16) & 0xff;
+    result[7] = (*length >> 24) & 0xff;
+
+    free(data);
+    *length = SAVEGAME_Z_HEADER + result_len;
+
+    return result;
+#else
+    return data;
+#endif
+}
+
+byte *P_UncompressSaveGame(const char *filename, byte *data, int *length)
+{
+    if (*length < SAVEGAME_Z_HEADER || memcmp(data, SAVEGAME_Z_MAGIC, 4))
+    {
+        return data;
+    }
+
+#ifdef HAVE_LIBZ
+    {
+        byte *result;
+        uLongf result_len;
+        unsigned int expected_len;
+
+        expected_len = data[4] | (data[5] << 8) | (data[6] << 16)
+                     | ((unsigned int) data[7] << 24);
+
+        if (expected_len == 0 || expected_len > SAVEGAME_Z_MAXLEN)
+        {
+            I_Error("Savegame %s is corrupt", filename);
+        }
+
+        result_len = expected_len;
+        result = Z_Malloc(result_len, PU_STATIC, NULL);
+
+        if (uncompress(result, &result_len, data + SAVEGAME_Z_HEADER,
+                       *length - SAVEGAME_Z_HEADER) != Z_OK
+         || result_len != expected_len)
+        {
+            I_Error("Savegame %s is corrupt", filename);
+        }
+
+        Z_Free(data);
+        *length = result_len;
+
+        return result;
+    }
+#else
+    I_Error("Savegame %s is compressed, but this build has no zlib "
+            "support", filename);
+
+    return NULL;
+#endif
+}
+
+// [AP] save_stream is an in-memory buffer; fields are packed straight
+// into it (little-endian) rather than going through a call per byte.
+
+static byte *saveg_reserve(int len)
+{
+    byte *p;
+
+    p = mem_fwrite_reserve(save_stream, len);
+
+    if (p == NULL && !savegame_error)
+    {
+        fprintf(stderr, "saveg_write: Error while writing save game\n");
+
+        savegame_error = true;
+    }
+
+    return p;
+}
+
 // Endian-safe integer read/write functions
 
 static byte saveg_read8(void)
 {
-    byte result = -1;
+    const byte *p;
 
-    if (fread(&result, 1, 1, save_stream) < 1)
+    p = mem_fread_ptr(save_stream, 1);
+
+    if (p == NULL)
     {
         if (!savegame_error)
         {
@@ -95,58 +325,91 @@ static byte saveg_read8(void)
 
             savegame_error = true;
         }
+
+        return -1;
     }
 
-    return result;
+    return p[0];
 }
 
 static void saveg_write8(byte value)
 {
-    if (fwrite(&value, 1, 1, save_stream) < 1)
-    {
-        if (!savegame_error)
-        {
-            fprintf(stderr, "saveg_write8: Error while writing save game\n");
+    byte *p;
 
-            savegame_error = true;
-        }
+    p = saveg_reserve(1);
+
+    if (p != NULL)
+    {
+        p[0] = value;
     }
 }
 
 static short saveg_read16(void)
 {
+    const byte *p;
     int result;
 
-    result = saveg_read8();
-    result |= saveg_read8() << 8;
+    p = mem_fread_ptr(save_stream, 2);
 
-    return result;
+    if (p == NULL)
+    {
+        // Short read; let saveg_read8() report it.
+
+        result = saveg_read8();
+        result |= saveg_read8() << 8;
+
+        return result;
+    }
+
+    return p[0] | (p[1] << 8);
 }
 
 static void saveg_write16(short value)
 {
-    saveg_write8(value & 0xff);
-    saveg_write8((value >> 8) & 0xff);
+    byte *p;
+
+    p = saveg_reserve(2);
+
+    if (p != NULL)
+    {
+        p[0] = value & 0xff;
+        p[1] = (value >> 8) & 0xff;
+    }
 }
 
 static int saveg_read32(void)
 {
+    const byte *p;
     int result;
 
-    result = saveg_read8();
-    result |= saveg_read8() << 8;
-    result |= saveg_read8() << 16;
-    result |= saveg_read8() << 24;
+    p = mem_fread_ptr(save_stream, 4);
 
-    return result;
+    if (p == NULL)
+    {
+        result = saveg_read8();
+        result |= saveg_read8() << 8;
+        result |= saveg_read8() << 16;
+        result |= saveg_read8() << 24;
+
+        return result;
+    }
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
 }
 
 static void saveg_write32(int value)
 {
-    saveg_write8(value & 0xff);
-    saveg_write8((value >> 8) & 0xff);
-    saveg_write8((value >> 16) & 0xff);
-    saveg_write8((value >> 24) & 0xff);
+    byte *p;
+
+    p = saveg_reserve(4);
+
+    if (p != NULL)
+    {
+        p[0] = value & 0xff;
+        p[1] = (value >> 8) & 0xff;
+        p[2] = (value >> 16) & 0xff;
+        p[3] = (value >> 24) & 0xff;
+    }
 }
 
 // Pad to 4-byte boundaries
@@ -157,7 +420,7 @@ static void saveg_read_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = mem_ftell(save_stream);
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -173,7 +436,7 @@ static void saveg_write_pad(void)
     int padding;
     int i;
 
-    pos = ftell(save_stream);
+    pos = mem_ftell(save_stream);
 
     padding = (4 - (pos & 3)) & 3;
 
@@ -454,7 +717,7 @@ uint32_t P_ThinkerToIndex (thinker_t* thinker)
     if (!thinker)
 	return 0;
 
-    for (th = thinkercap.next, i = 0; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext, i = 0; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1) P_MobjThinker)
 	{
@@ -476,7 +739,7 @@ thinker_t* P_IndexToThinker (uint32_t index)
     if (!index)
 	return NULL;
 
-    for (th = thinkercap.next, i = 0; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext, i = 0; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1) P_MobjThinker)
 	{
@@ -1576,49 +1839,250 @@ void P_UnArchivePlayers (void)
 }
 
 
+// [AP] Sector, line and side fields exactly as they are archived.  In
+// delta mode only the entries that differ from the state recorded by
+// P_RecordWorldBaseline() (the freshly set-up level) are written.
+
+#define SECTOR_FIELDS 7
+#define LINE_FIELDS   3
+#define SIDE_FIELDS   5
+
+boolean savegame_world_is_delta;
+
+static short *baseline_sectors;
+static short *baseline_lines;
+static short *baseline_sides;
+
+static void GetSectorFields(const sector_t *sec, short *f)
+{
+    f[0] = sec->floorheight >> FRACBITS;
+    f[1] = sec->ceilingheight >> FRACBITS;
+    f[2] = sec->floorpic;
+    f[3] = sec->ceilingpic;
+    f[4] = sec->lightlevel;
+    f[5] = sec->special;
+    f[6] = sec->tag;
+}
+
+static void GetLineFields(const line_t *li, short *f)
+{
+    f[0] = li->flags;
+    f[1] = li->special;
+    f[2] = li->tag;
+}
+
+static void GetSideFields(const side_t *si, short *f)
+{
+    f[0] = si->textureoffset >> FRACBITS;
+    f[1] = si->rowoffset >> FRACBITS;
+    f[2] = si->toptexture;
+    f[3] = si->bottomtexture;
+    f[4] = si->midtexture;
+}
+
+void P_RecordWorldBaseline (void)
+{
+    int i;
+
+    baseline_sectors = Z_Malloc(numsectors * SECTOR_FIELDS * sizeof(short),
+                                PU_LEVEL, &baseline_sectors);
+    baseline_lines = Z_Malloc(numlines * LINE_FIELDS * sizeof(short),
+                              PU_LEVEL, &baseline_lines);
+    baseline_sides = Z_Malloc(numsides * SIDE_FIELDS * sizeof(short),
+                              PU_LEVEL, &baseline_sides);
+
+    for (i = 0; i < numsectors; i++)
+    {
+        GetSectorFields(&sectors[i], &baseline_sectors[i * SECTOR_FIELDS]);
+    }
+    for (i = 0; i < numlines; i++)
+    {
+        GetLineFields(&lines[i], &baseline_lines[i * LINE_FIELDS]);
+    }
+    for (i = 0; i < numsides; i++)
+    {
+        GetSideFields(&sides[i], &baseline_sides[i * SIDE_FIELDS]);
+    }
+}
+
+static boolean SectorChanged(int i)
+{
+    short f[SECTOR_FIELDS];
+
+    GetSectorFields(&sectors[i], f);
+
+    return memcmp(f, &baseline_sectors[i * SECTOR_FIELDS], sizeof(f)) != 0;
+}
+
+// A line and its sides are saved as a unit.
+
+static boolean LineChanged(int i)
+{
+    short f[SIDE_FIELDS];
+    line_t *li = &lines[i];
+    int j;
+
+    GetLineFields(li, f);
+
+    if (memcmp(f, &baseline_lines[i * LINE_FIELDS],
+               LINE_FIELDS * sizeof(short)))
+    {
+        return true;
+    }
+
+    for (j=0 ; j<2 ; j++)
+    {
+        if (li->sidenum[j] == NO_INDEX) // [crispy] extended nodes
+            continue;
+
+        GetSideFields(&sides[li->sidenum[j]], f);
+
+        if (memcmp(f, &baseline_sides[li->sidenum[j] * SIDE_FIELDS],
+                   sizeof(f)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void ArchiveSector(const sector_t *sec)
+{
+    short f[SECTOR_FIELDS];
+    int i;
+
+    GetSectorFields(sec, f);
+
+    for (i = 0; i < SECTOR_FIELDS; i++)
+    {
+        saveg_write16(f[i]);
+    }
+}
+
+static void ArchiveLine(const line_t *li)
+{
+    short f[SIDE_FIELDS];
+    int i, j;
+
+    GetLineFields(li, f);
+
+    for (i = 0; i < LINE_FIELDS; i++)
+    {
+        saveg_write16(f[i]);
+    }
+
+    for (j=0 ; j<2 ; j++)
+    {
+        if (li->sidenum[j] == NO_INDEX) // [crispy] extended nodes
+            continue;
+
+        GetSideFields(&sides[li->sidenum[j]], f);
+
+        for (i = 0; i < SIDE_FIELDS; i++)
+        {
+            saveg_write16(f[i]);
+        }
+    }
+}
+
+static void UnArchiveSector(sector_t *sec)
+{
+    // [crispy] add overflow guard for the flattranslation[] array
+    short floorpic, ceilingpic;
+    sec->floorheight = saveg_read16() << FRACBITS;
+    sec->ceilingheight = saveg_read16() << FRACBITS;
+    floorpic = saveg_read16();
+    ceilingpic = saveg_read16();
+    sec->lightlevel = saveg_read16();
+    sec->rlightlevel = sec->lightlevel; // [crispy] A11Y
+    sec->special = saveg_read16();		// needed?
+    sec->tag = saveg_read16();		// needed?
+    // [crispy] add overflow guard for the flattranslation[] array
+    if (floorpic >= 0 && floorpic < numflats)
+    {
+        sec->floorpic = floorpic;
+    }
+    if (ceilingpic >= 0 && ceilingpic < numflats)
+    {
+        sec->ceilingpic = ceilingpic;
+    }
+}
+
+static void UnArchiveLine(line_t *li)
+{
+    side_t *si;
+    int j;
+
+    li->flags = saveg_read16();
+    li->special = saveg_read16();
+    li->tag = saveg_read16();
+    for (j=0 ; j<2 ; j++)
+    {
+        if (li->sidenum[j] == NO_INDEX) // [crispy] extended nodes
+            continue;
+        si = &sides[li->sidenum[j]];
+        si->textureoffset = saveg_read16() << FRACBITS;
+        si->rowoffset = saveg_read16() << FRACBITS;
+        si->toptexture = saveg_read16();
+        si->bottomtexture = saveg_read16();
+        si->midtexture = saveg_read16();
+    }
+}
+
 //
 // P_ArchiveWorld
 //
 void P_ArchiveWorld (void)
 {
     int			i;
-    int			j;
-    sector_t*		sec;
-    line_t*		li;
-    side_t*		si;
-    
+    int			count;
+
+    // [AP] Delta mode: the changed entries, each preceded by its index.
+    savegame_world_is_delta = savegame_delta && baseline_sectors != NULL;
+
+    if (savegame_world_is_delta)
+    {
+        for (i=0, count=0 ; i<numsectors ; i++)
+            count += SectorChanged(i);
+
+        saveg_write32(count);
+        for (i=0 ; i<numsectors ; i++)
+        {
+            if (SectorChanged(i))
+            {
+                saveg_write32(i);
+                ArchiveSector(&sectors[i]);
+            }
+        }
+
+        for (i=0, count=0 ; i<numlines ; i++)
+            count += LineChanged(i);
+
+        saveg_write32(count);
+        for (i=0 ; i<numlines ; i++)
+        {
+            if (LineChanged(i))
+            {
+                saveg_write32(i);
+                ArchiveLine(&lines[i]);
+            }
+        }
+
+        return;
+    }
+
     // do sectors
-    for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
+    for (i=0 ; i<numsectors ; i++)
     {
-	saveg_write16(sec->floorheight >> FRACBITS);
-	saveg_write16(sec->ceilingheight >> FRACBITS);
-	saveg_write16(sec->floorpic);
-	saveg_write16(sec->ceilingpic);
-	saveg_write16(sec->lightlevel);
-	saveg_write16(sec->special);		// needed?
-	saveg_write16(sec->tag);		// needed?
+	ArchiveSector(&sectors[i]);
     }
 
     
     // do lines
-    for (i=0, li = lines ; i<numlines ; i++,li++)
+    for (i=0 ; i<numlines ; i++)
     {
-	saveg_write16(li->flags);
-	saveg_write16(li->special);
-	saveg_write16(li->tag);
-	for (j=0 ; j<2 ; j++)
-	{
-	    if (li->sidenum[j] == NO_INDEX) // [crispy] extended nodes
-		continue;
-	    
-	    si = &sides[li->sidenum[j]];
-
-	    saveg_write16(si->textureoffset >> FRACBITS);
-	    saveg_write16(si->rowoffset >> FRACBITS);
-	    saveg_write16(si->toptexture);
-	    saveg_write16(si->bottomtexture);
-	    saveg_write16(si->midtexture);	
-	}
+	ArchiveLine(&lines[i]);
     }
 }
 
@@ -1630,54 +2094,52 @@ void P_ArchiveWorld (void)
 void P_UnArchiveWorld (void)
 {
     int			i;
-    int			j;
-    sector_t*		sec;
-    line_t*		li;
-    side_t*		si;
-    
+    int			count;
+
+    // [AP] sector heights are about to change
+    P_ClearSightMemo();
+
+    for (i=0 ; i<numsectors ; i++)
+    {
+	sectors[i].specialdata = 0;
+	sectors[i].soundtarget = 0;
+    }
+
+    // [AP] Delta mode: everything not in the savegame keeps the state
+    // P_SetupLevel just gave it.
+    if (savegame_world_is_delta)
+    {
+        count = saveg_read32();
+        while (count-- > 0 && !savegame_error)
+        {
+            i = saveg_read32();
+            if (i < 0 || i >= numsectors)
+                I_Error("P_UnArchiveWorld: Bad sector %d in savegame", i);
+            UnArchiveSector(&sectors[i]);
+        }
+
+        count = saveg_read32();
+        while (count-- > 0 && !savegame_error)
+        {
+            i = saveg_read32();
+            if (i < 0 || i >= numlines)
+                I_Error("P_UnArchiveWorld: Bad line %d in savegame", i);
+            UnArchiveLine(&lines[i]);
+        }
+
+        return;
+    }
+
     // do sectors
-    for (i=0, sec = sectors ; i<numsectors ; i++,sec++)
-    {
-	// [crispy] add overflow guard for the flattranslation[] array
-	short floorpic, ceilingpic;
-	sec->floorheight = saveg_read16() << FRACBITS;
-	sec->ceilingheight = saveg_read16() << FRACBITS;
-	floorpic = saveg_read16();
-	ceilingpic = saveg_read16();
-	sec->lightlevel = saveg_read16();
-	sec->rlightlevel = sec->lightlevel; // [crispy] A11Y
-	sec->special = saveg_read16();		// needed?
-	sec->tag = saveg_read16();		// needed?
-	sec->specialdata = 0;
-	sec->soundtarget = 0;
-	// [crispy] add overflow guard for the flattranslation[] array
-	if (floorpic >= 0 && floorpic < numflats)
-	{
-	    sec->floorpic = floorpic;
-	}
-	if (ceilingpic >= 0 && ceilingpic < numflats)
-	{
-	    sec->ceilingpic = ceilingpic;
-	}
+    for (i=0 ; i<numsectors ; i++)
+    {
+	UnArchiveSector(&sectors[i]);
     }
     
     // do lines
-    for (i=0, li = lines ; i<numlines ; i++,li++)
+    for (i=0 ; i<numlines ; i++)
     {
-	li->flags = saveg_read16();
-	li->special = saveg_read16();
-	li->tag = saveg_read16();
-	for (j=0 ; j<2 ; j++)
-	{
-	    if (li->sidenum[j] == NO_INDEX) // [crispy] extended nodes
-		continue;
-	    si = &sides[li->sidenum[j]];
-	    si->textureoffset = saveg_read16() << FRACBITS;
-	    si->rowoffset = saveg_read16() << FRACBITS;
-	    si->toptexture = saveg_read16();
-	    si->bottomtexture = saveg_read16();
-	    si->midtexture = saveg_read16();
-	}
+	UnArchiveLine(&lines[i]);
     }
 }
 
@@ -1704,7 +2166,7 @@ void P_ArchiveThinkers (void)
     thinker_t*		th;
 
     // save off the current thinkers
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ; th != &thinkerclasscap[th_mobj] ; th=th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 	{
@@ -1790,7 +2252,7 @@ void P_RestoreTargets (void)
     mobj_t*	mo;
     thinker_t*	th;
 
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1) P_MobjThinker)
 	{
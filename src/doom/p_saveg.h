@@ -22,6 +22,8 @@
 
 #include <stdio.h>
 
+#include "memio.h"
+
 #define SAVEGAME_EOF 0x1d
 #define VERSIONSIZE 16
 
@@ -37,6 +39,24 @@ char *P_TempSaveGameFile(void);
 
 char *P_SaveGameFile(int slot);
 
+// [AP] In-memory copies of the most recently saved or loaded levels, so
+// that switching back to one does not have to touch the disk.  The cache
+// keeps its own copy of data, outside the zone, and returns it.  Whoever
+// removes a savegame from disk must also drop it from the cache.
+
+byte *P_StoreLevelSnapshot(const char *filename, const byte *data, int length);
+boolean P_FindLevelSnapshot(const char *filename, byte **data, int *length);
+void P_ForgetLevelSnapshot(const char *filename);
+void P_ClearLevelSnapshots(void);
+
+// [AP] Optional zlib-compressed savegame container.  P_CompressSaveGame
+// is an I_WriteFileAsync() filter; P_UncompressSaveGame takes a savegame
+// read from disk (Z_Malloc'ed) and returns it uncompressed, passing
+// plain savegames through unchanged.
+
+void *P_CompressSaveGame(void *data, int *length);
+byte *P_UncompressSaveGame(const char *filename, byte *data, int *length);
+
 // Savegame file header read/write functions
 
 boolean P_ReadSaveGameHeader(void);
@@ -51,6 +71,10 @@ void P_WriteSaveGameEOF(void);
 // These are the load / save game routines.
 void P_ArchivePlayers (void);
 void P_UnArchivePlayers (void);
+// [AP] Remember the freshly set-up sectors, lines and sides so delta
+// savegames can store only what changed since.
+void P_RecordWorldBaseline (void);
+
 void P_ArchiveWorld (void);
 void P_UnArchiveWorld (void);
 void P_ArchiveThinkers (void);
@@ -59,8 +83,9 @@ void P_ArchiveSpecials (void);
 void P_UnArchiveSpecials (void);
 void P_RestoreTargets (void);
 
-extern FILE *save_stream;
+extern MEMFILE *save_stream;
 extern boolean savegame_error;
+extern boolean savegame_world_is_delta; // [AP]
 
 
 #endif
@@ -31,13 +31,17 @@
 #include "m_misc.h" // [crispy] M_StringJoin()
 
 #include "g_game.h"
+#include "p_saveg.h"
 
 #include "i_system.h"
+#include "i_thread.h" // [AP] I_ParallelFor()
 #include "w_wad.h"
 
 #include "doomdef.h"
 #include "p_local.h"
 #include "p_rejectpad.h"
+#include "p_reject.h" // [AP] P_GenerateReject()
+#include "p_thingindex.h" // [AP] P_InitThingIndex()
 
 #include "s_sound.h"
 #include "s_musinfo.h" // [crispy] S_ParseMusInfo()
@@ -299,12 +303,18 @@ static angle_t anglediff(angle_t a, angle_t b)
 		return b - a;
 }
 
-void P_SegLengths (boolean contrast_only)
+// [AP] Segs are independent of each other, so they are handed out to
+// worker threads in batches.
+#define SEGLENGTHS_BATCH 4096
+
+static void P_SegLengthsBatch (void *data, int batch)
 {
-    int i;
+    const boolean contrast_only = *(boolean *) data;
     const int rightangle = abs(finesine[(ANG60/2) >> ANGLETOFINESHIFT]);
+    const int last = MIN(numsegs, (batch + 1) * SEGLENGTHS_BATCH);
+    int i;
 
-    for (i = 0; i < numsegs; i++)
+    for (i = batch * SEGLENGTHS_BATCH; i < last; i++)
     {
 	seg_t *const li = &segs[i];
 	int64_t dx, dy;
@@ -317,9 +327,8 @@ void P_SegLengths (boolean contrast_only)
 		li->length = (uint32_t)(sqrt((double)dx*dx + (double)dy*dy)/2);
 
 		// [crispy] re-calculate angle used for rendering
-		viewx = li->v1->r_x;
-		viewy = li->v1->r_y;
-		li->r_angle = R_PointToAngleCrispy(li->v2->r_x, li->v2->r_y);
+		li->r_angle = R_PointToAngleCrispy2(li->v1->r_x, li->v1->r_y,
+		                                    li->v2->r_x, li->v2->r_y);
 		// [crispy] more than just a little adjustment?
 		// back to the original angle then
 		if (anglediff(li->r_angle, li->angle) > ANG60/2)
@@ -345,6 +354,12 @@ void P_SegLengths (boolean contrast_only)
     }
 }
 
+void P_SegLengths (boolean contrast_only)
+{
+    I_ParallelFor(P_SegLengthsBatch, &contrast_only,
+                  (numsegs + SEGLENGTHS_BATCH - 1) / SEGLENGTHS_BATCH);
+}
+
 //
 // P_LoadSubsectors
 //
@@ -1150,6 +1165,7 @@ static void P_LoadReject(int lumpnum)
 {
     int minlength;
     int lumplen;
+    int i, len;
 
     // Calculate the size that the REJECT lump *should* be.
 
@@ -1172,6 +1188,24 @@ static void P_LoadReject(int lumpnum)
 
         PadRejectArray(rejectmatrix + lumplen, minlength - lumplen, totallines);
     }
+
+    // [AP] Most node builders leave REJECT empty. If it doesn't reject
+    // anything, generate a matrix that does.
+
+    len = lumplen < minlength ? lumplen : minlength;
+
+    for (i = 0; i < len && !rejectmatrix[i]; i++);
+
+    if (i == len)
+    {
+        P_GenerateReject();
+    }
+    else
+    {
+        P_FreeGeneratedReject();
+    }
+
+    P_ClearSightMemo();
 }
 
 // [crispy] log game skill in plain text
@@ -1351,6 +1385,13 @@ P_SetupLevel
     // [crispy] check and log map and nodes format
     crispy_mapformat = P_CheckMapFormat(lumpnum);
 
+    // [AP] Independent stages of the load run alongside the main sequence:
+    // compressed nodes are inflated from here on, a missing blockmap is
+    // built once the lines are in, and a generated REJECT once the
+    // sectors are grouped. Each is collected where it is first needed.
+    if (crispy_mapformat & MFMT_ZDBSPZ)
+	P_StartNodesInflate (lumpnum+ML_NODES);
+
     // note: most of this ordering is important	
     crispy_validblockmap = P_LoadBlockMap (lumpnum+ML_BLOCKMAP); // [crispy] (re-)create BLOCKMAP if necessary
     P_LoadVertexes (lumpnum+ML_VERTEXES);
@@ -1363,10 +1404,7 @@ P_SetupLevel
     P_LoadLineDefs (lumpnum+ML_LINEDEFS);
     // [crispy] (re-)create BLOCKMAP if necessary
     if (!crispy_validblockmap)
-    {
-	extern void P_CreateBlockMap (void);
-	P_CreateBlockMap();
-    }
+	P_CreateBlockMap(lumpnum);
     if (crispy_mapformat & (MFMT_ZDBSPX | MFMT_ZDBSPZ))
 	P_LoadNodes_ZDBSP (lumpnum+ML_NODES, crispy_mapformat & MFMT_ZDBSPZ);
     else
@@ -1390,6 +1428,9 @@ P_SetupLevel
     P_RemoveSlimeTrails();
     // [crispy] fix long wall wobble
     P_SegLengths(false);
+    // [AP] things are linked into the blockmap
+    P_FinishBlockMap();
+    P_InitThingIndex();
     // [crispy] blinking key or skull in the status bar
     memset(st_keyorskull, 0, sizeof(st_keyorskull));
 
@@ -1432,6 +1473,9 @@ P_SetupLevel
 
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
+    // [AP] reference state for delta savegames
+    P_RecordWorldBaseline ();
+
     // [AP] set up keys for crispy hud
     {
         ap_level_info_t* level_info = ap_get_level_info(ap_make_level_index(gameepisode, gamemap));
@@ -22,6 +22,7 @@
 
 #include "i_system.h"
 #include "p_local.h"
+#include "p_reject.h" // [AP] genrejectmatrix
 
 // State.
 #include "r_state.h"
@@ -39,6 +40,40 @@ fixed_t		t2y;
 
 int		sightcounts[2];
 
+// [AP] Memo of recent sight checks. A check only depends on where the
+// two mobjs are and on sector heights, so as long as no floor or ceiling
+// has moved the same question gets the same answer. Monsters often ask
+// it more than once per tic (melee range, then missile range).
+
+#define SIGHTMEMO_SIZE 2048
+
+typedef struct
+{
+    fixed_t x1, y1, z1, height1;
+    fixed_t x2, y2, z2, height2;
+    unsigned int stamp;
+    boolean result;
+} sightmemo_t;
+
+static sightmemo_t sightmemo[SIGHTMEMO_SIZE];
+static unsigned int sightstamp = 1;
+
+void P_ClearSightMemo (void)
+{
+    ++sightstamp;
+}
+
+static sightmemo_t *P_SightMemoEntry (mobj_t *t1, mobj_t *t2)
+{
+    unsigned int hash;
+
+    hash = (unsigned int) (t1->x ^ (t1->y >> 7) ^ (t1->z >> 3)
+                         ^ (t2->x >> 5) ^ (t2->y >> 11) ^ (t2->z >> 9));
+    hash *= 2654435769u;
+
+    return &sightmemo[hash >> 21];
+}
+
 
 // PTR_SightTraverse() for Doom 1.2 sight calculations
 // taken from prboom-plus/src/p_sight.c:69-102
@@ -345,6 +380,7 @@ P_CheckSight
     int		pnum;
     int		bytenum;
     int		bitnum;
+    sightmemo_t	*memo;
     
     // First check for trivial rejection.
 
@@ -364,6 +400,15 @@ P_CheckSight
 	return false;	
     }
 
+    // [AP] Same for the generated matrix. Left out of demos and netgames,
+    // which have to behave exactly as recorded or as on the other nodes.
+    if (genrejectmatrix && (genrejectmatrix[bytenum]&bitnum)
+        && !demoplayback && !demorecording && !netgame)
+    {
+	sightcounts[0]++;
+	return false;
+    }
+
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
@@ -380,6 +425,18 @@ P_CheckSight
                               PT_EARLYOUT | PT_ADDLINES, PTR_SightTraverse);
     }
 
+    // [AP] asked already?
+    memo = P_SightMemoEntry(t1, t2);
+
+    if (memo->stamp == sightstamp
+     && memo->x1 == t1->x && memo->y1 == t1->y
+     && memo->z1 == t1->z && memo->height1 == t1->height
+     && memo->x2 == t2->x && memo->y2 == t2->y
+     && memo->z2 == t2->z && memo->height2 == t2->height)
+    {
+	return memo->result;
+    }
+
     strace.x = t1->x;
     strace.y = t1->y;
     t2x = t2->x;
@@ -388,7 +445,18 @@ P_CheckSight
     strace.dy = t2->y - t1->y;
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    memo->result = P_CrossBSPNode (numnodes-1);
+    memo->stamp = sightstamp;
+    memo->x1 = t1->x;
+    memo->y1 = t1->y;
+    memo->z1 = t1->z;
+    memo->height1 = t1->height;
+    memo->x2 = t2->x;
+    memo->y2 = t2->y;
+    memo->z2 = t2->z;
+    memo->height2 = t2->height;
+
+    return memo->result;
 }
 
 
@@ -0,0 +1,407 @@
+//
+// Copyright(C) 2026 Archipelago Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[AP] Array-backed index of the things in each blockmap cell.
+//
+//	Every cell keeps its things in contiguous arrays, along with a copy
+//	of their positions and radii, in the order they were linked. The
+//	blocklinks chains have new things added at the head, so walking an
+//	array backwards visits things in exactly the order the chain does.
+//	Collision checks use the copies to skip, a batch at a time, the
+//	things that are too far away to touch, without loading them.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "m_argv.h"
+#include "p_local.h"
+#include "p_thingindex.h"
+
+// Things are tested in batches of this many, in a loop over plain arrays
+// that the compiler can turn into vector code.
+#define BATCH_SIZE 8
+
+typedef struct
+{
+    mobj_t **mobjs;          // NULL where a thing has been unlinked
+    fixed_t *x, *y, *radius;
+    int count;               // slots in use, unlinked ones included
+    int numunlinked;
+    int numalloc;
+
+    // P_UnsetThingPosition finds the head of a chain from the position
+    // of the thing being unlinked. If it was moved without being
+    // relinked, that is the wrong chain, and vanilla goes on to mangle
+    // the chains of the cells involved. The index can't follow that, so
+    // those cells go back to walking blocklinks for the rest of the level.
+    boolean listonly;
+} thingcell_t;
+
+static thingcell_t *cells = NULL;
+static int numcells = 0;
+static boolean index_enabled = false;
+
+// Nesting depth of P_BlockThingsIteratorNear. Cells are only compacted
+// when this is zero, so that the slots being walked stay put.
+static int iterating = 0;
+
+void P_InitThingIndex(void)
+{
+    int i;
+
+    for (i = 0; i < numcells; i++)
+    {
+        free(cells[i].mobjs);
+        free(cells[i].x);
+        free(cells[i].y);
+        free(cells[i].radius);
+    }
+
+    free(cells);
+    cells = NULL;
+    numcells = 0;
+
+    //!
+    // @category obscure
+    //
+    // Don't keep an index of the things in each blockmap cell; check
+    // collisions by walking the blockmap chains as vanilla does.
+    //
+
+    index_enabled = !M_ParmExists("-nothingindex");
+
+    if (index_enabled)
+    {
+        numcells = bmapwidth * bmapheight;
+        cells = calloc(numcells, sizeof(*cells));
+    }
+}
+
+static void CompactCell(thingcell_t *cell)
+{
+    int i, n = 0;
+
+    for (i = 0; i < cell->count; i++)
+    {
+        if (cell->mobjs[i] != NULL)
+        {
+            cell->mobjs[n] = cell->mobjs[i];
+            cell->x[n] = cell->x[i];
+            cell->y[n] = cell->y[i];
+            cell->radius[n] = cell->radius[i];
+            cell->mobjs[n]->bindex = n;
+            n++;
+        }
+    }
+
+    cell->count = n;
+    cell->numunlinked = 0;
+}
+
+static void GrowCell(thingcell_t *cell)
+{
+    cell->numalloc = cell->numalloc ? cell->numalloc * 2 : 8;
+    cell->mobjs = I_Realloc(cell->mobjs, cell->numalloc * sizeof(*cell->mobjs));
+    cell->x = I_Realloc(cell->x, cell->numalloc * sizeof(*cell->x));
+    cell->y = I_Realloc(cell->y, cell->numalloc * sizeof(*cell->y));
+    cell->radius = I_Realloc(cell->radius,
+                             cell->numalloc * sizeof(*cell->radius));
+}
+
+// The cell a thing is linked into, or NULL if it isn't in the index.
+
+static thingcell_t *ThingCell(mobj_t *thing)
+{
+    thingcell_t *cell;
+
+    if (!index_enabled || thing->bcell < 0 || thing->bcell >= numcells)
+    {
+        return NULL;
+    }
+
+    cell = &cells[thing->bcell];
+
+    if (thing->bindex < 0 || thing->bindex >= cell->count
+     || cell->mobjs[thing->bindex] != thing)
+    {
+        return NULL;
+    }
+
+    return cell;
+}
+
+static void SetListOnly(int cell)
+{
+    if (cell >= 0 && cell < numcells)
+    {
+        cells[cell].listonly = true;
+    }
+}
+
+void P_LinkThingIndex(mobj_t *thing, int cell)
+{
+    thingcell_t *c;
+    int i;
+
+    thing->bcell = -1;
+
+    if (!index_enabled || cell < 0)
+    {
+        return;
+    }
+
+    // The old head of the chain, now behind the thing, has to be one of
+    // the cell's own, or a mangled chain has just been spliced in.
+    if (thing->bnext != NULL && thing->bnext->bcell != cell)
+    {
+        SetListOnly(cell);
+        SetListOnly(thing->bnext->bcell);
+    }
+
+    c = &cells[cell];
+
+    if (c->count == c->numalloc)
+    {
+        if (c->numunlinked > 0 && iterating == 0)
+        {
+            CompactCell(c);
+        }
+
+        if (c->count == c->numalloc)
+        {
+            GrowCell(c);
+        }
+    }
+
+    i = c->count++;
+    c->mobjs[i] = thing;
+    c->x[i] = thing->x;
+    c->y[i] = thing->y;
+    c->radius[i] = thing->radius;
+
+    thing->bcell = cell;
+    thing->bindex = i;
+}
+
+// Called before P_UnsetThingPosition touches the chains. Unless the
+// thing's neighbours and the chain head all agree with the index, the
+// unlink is going to mangle some chain, so every cell it may touch is
+// given up on.
+
+void P_UnlinkThingIndex(mobj_t *thing)
+{
+    thingcell_t *cell;
+    mobj_t *prev = thing->bprev;
+    mobj_t *next = thing->bnext;
+    int head = -1;
+    boolean intact;
+
+    if (!index_enabled)
+    {
+        return;
+    }
+
+    cell = ThingCell(thing);
+
+    if (prev == NULL)
+    {
+        int blockx = (thing->x - bmaporgx) >> MAPBLOCKSHIFT;
+        int blocky = (thing->y - bmaporgy) >> MAPBLOCKSHIFT;
+
+        if (blockx >= 0 && blockx < bmapwidth
+         && blocky >= 0 && blocky < bmapheight)
+        {
+            head = blocky * bmapwidth + blockx;
+        }
+    }
+
+    if (cell == NULL)
+    {
+        intact = prev == NULL && next == NULL && head < 0;
+    }
+    else
+    {
+        intact = (prev != NULL ?
+                  prev->bnext == thing && prev->bcell == thing->bcell
+                  && blocklinks[thing->bcell] != thing :
+                  head == thing->bcell && blocklinks[head] == thing)
+              && (next == NULL ||
+                  (next->bprev == thing && next->bcell == thing->bcell));
+    }
+
+    if (!intact)
+    {
+        SetListOnly(head);
+
+        if (cell != NULL)
+        {
+            cell->listonly = true;
+        }
+
+        if (prev != NULL)
+        {
+            SetListOnly(prev->bcell);
+        }
+
+        if (next != NULL)
+        {
+            SetListOnly(next->bcell);
+        }
+    }
+
+    if (cell == NULL)
+    {
+        return;
+    }
+
+    cell->mobjs[thing->bindex] = NULL;
+    cell->numunlinked++;
+    thing->bcell = -1;
+
+    if (iterating == 0 && cell->numunlinked > cell->count / 2)
+    {
+        CompactCell(cell);
+    }
+}
+
+void P_UpdateThingIndex(mobj_t *thing)
+{
+    thingcell_t *cell = ThingCell(thing);
+
+    if (cell != NULL)
+    {
+        cell->x[thing->bindex] = thing->x;
+        cell->y[thing->bindex] = thing->y;
+        cell->radius[thing->bindex] = thing->radius;
+    }
+}
+
+// abs(a - b) with the wraparound of the plain int arithmetic in
+// PIT_CheckThing, so that the same things are skipped.
+
+static inline fixed_t AbsDiff(fixed_t a, fixed_t b)
+{
+    unsigned int d = (unsigned int) a - (unsigned int) b;
+
+    return (fixed_t) ((fixed_t) d < 0 ? 0u - d : d);
+}
+
+// Bit i - first is set for every slot i in [first, last) holding a thing
+// that might be touched.
+
+static unsigned int NearMask(const thingcell_t *cell, int first, int last,
+                             fixed_t cx, fixed_t cy, fixed_t radius)
+{
+    unsigned int mask = 0;
+    int i;
+
+    for (i = first; i < last; i++)
+    {
+        fixed_t blockdist = cell->radius[i] + radius;
+        unsigned int near = AbsDiff(cell->x[i], cx) < blockdist
+                          && AbsDiff(cell->y[i], cy) < blockdist;
+
+        mask |= near << (i - first);
+    }
+
+    return mask;
+}
+
+boolean P_BlockThingsIteratorNear(int x, int y,
+                                  const fixed_t *cx, const fixed_t *cy,
+                                  mobj_t *const *thing,
+                                  boolean (*func)(mobj_t *))
+{
+    thingcell_t *cell;
+    mobj_t *mobj;
+    boolean result = true;
+    int i;
+
+    if (!index_enabled
+     || x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+    {
+        return P_BlockThingsIterator(x, y, func);
+    }
+
+    cell = &cells[y * bmapwidth + x];
+
+    // The newest thing has to be at the head of the chain, or something
+    // has got past the checks above.
+    if (!cell->listonly)
+    {
+        for (i = cell->count - 1; i >= 0 && cell->mobjs[i] == NULL; i--);
+
+        if ((i >= 0 ? cell->mobjs[i] : NULL) != blocklinks[y * bmapwidth + x])
+        {
+            cell->listonly = true;
+        }
+    }
+
+    if (cell->listonly)
+    {
+        return P_BlockThingsIterator(x, y, func);
+    }
+
+    iterating++;
+
+    for (i = cell->count - 1; i >= 0; )
+    {
+        int first = i >= BATCH_SIZE ? i + 1 - BATCH_SIZE : 0;
+        unsigned int near = NearMask(cell, first, i + 1,
+                                     *cx, *cy, (*thing)->radius);
+
+        while (i >= first && (cell->mobjs[i] == NULL
+                              || !(near & (1u << (i - first)))))
+        {
+            i--;
+        }
+
+        if (i < first)
+        {
+            continue;
+        }
+
+        mobj = cell->mobjs[i];
+
+        if (!func(mobj))
+        {
+            result = false;
+            break;
+        }
+
+        // If func unlinked the thing, the chain carries on from where it
+        // was, wherever that is now; follow it just as vanilla does.
+        if (cell->mobjs[i] != mobj)
+        {
+            for (mobj = mobj->bnext; mobj != NULL; mobj = mobj->bnext)
+            {
+                if (!func(mobj))
+                {
+                    result = false;
+                    break;
+                }
+            }
+
+            break;
+        }
+
+        i--;
+    }
+
+    iterating--;
+
+    return result;
+}
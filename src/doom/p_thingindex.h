@@ -0,0 +1,47 @@
+//
+// Copyright(C) 2026 Archipelago Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[AP] Array-backed index of the things in each blockmap cell.
+//
+
+#ifndef __P_THINGINDEX__
+#define __P_THINGINDEX__
+
+#include "p_mobj.h"
+
+// Set up an empty index for the level's blockmap. Called once blocklinks
+// has been allocated, before any thing is spawned.
+void P_InitThingIndex(void);
+
+// Kept in step with the blocklinks chains by P_SetThingPosition and
+// P_UnsetThingPosition. cell is the block the thing goes into, or -1
+// if it is off the map.
+void P_LinkThingIndex(mobj_t *thing, int cell);
+void P_UnlinkThingIndex(mobj_t *thing);
+
+// Must be called when a thing in the blockmap has its position or radius
+// changed without being unlinked first.
+void P_UpdateThingIndex(mobj_t *thing);
+
+// Like P_BlockThingsIterator, but only calls func for things whose
+// bounding box might overlap that of *thing centred on (*x, *y): things
+// for which abs(thing->x - *x) >= thing->radius + (*thing)->radius, or
+// the same for y, are skipped. Everything is read afresh after each call
+// to func, so func may move things or change what the pointers refer to.
+boolean P_BlockThingsIteratorNear(int x, int y,
+                                  const fixed_t *cx, const fixed_t *cy,
+                                  mobj_t *const *thing,
+                                  boolean (*func)(mobj_t *));
+
+#endif
@@ -18,9 +18,15 @@
 //
 
 
+#include <stdio.h>
+#include <string.h>
+
 #include "z_zone.h"
 #include "p_local.h"
+#include "p_tick.h"
+#include "i_timer.h"
 #include "s_musinfo.h" // [crispy] T_MAPMusic()
+#include "p_reject.h" // [AP] P_UpdateGeneratedReject()
 
 #include "doomstat.h"
 
@@ -41,6 +47,9 @@ int leveltimesinceload;
 // Both the head and tail of the thinker list.
 thinker_t	thinkercap;
 
+// [AP] Heads and tails of the per-class thinker lists.
+thinker_t	thinkerclasscap[NUMTHINKERCLASSES];
+
 int init_thinkers_count = 0;
 
 //
@@ -48,23 +57,71 @@ int init_thinkers_count = 0;
 //
 void P_InitThinkers (void)
 {
+    int i;
+
     thinkercap.prev = thinkercap.next  = &thinkercap;
+
+    for (i = 0; i < NUMTHINKERCLASSES; i++)
+    {
+	thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
+    }
+
     ++init_thinkers_count;
 }
 
 
+// [AP] Class of a thinker, by its function. Movers in stasis have no
+// function, which is why movers are the default.
+
+static thclass_t P_ThinkerClass (thinker_t* thinker)
+{
+    actionf_p1 func = thinker->function.acp1;
+
+    if (func == (actionf_p1) P_MobjThinker)
+    {
+	return th_mobj;
+    }
+    else if (func == (actionf_p1) T_LightFlash
+          || func == (actionf_p1) T_StrobeFlash
+          || func == (actionf_p1) T_Glow
+          || func == (actionf_p1) T_FireFlicker)
+    {
+	return th_light;
+    }
+
+    return th_mover;
+}
 
 
 //
 // P_AddThinker
 // Adds a new thinker at the end of the list.
+// The thinker function must already be set.
 //
 void P_AddThinker (thinker_t* thinker)
 {
+    thinker_t *cap = &thinkerclasscap[P_ThinkerClass(thinker)];
+
     thinkercap.prev->next = thinker;
     thinker->next = &thinkercap;
     thinker->prev = thinkercap.prev;
     thinkercap.prev = thinker;
+
+    cap->cprev->cnext = thinker;
+    thinker->cnext = cap;
+    thinker->cprev = cap->cprev;
+    cap->cprev = thinker;
+}
+
+
+// [AP] Takes a thinker out of both lists, before it is freed.
+
+static void P_UnlinkThinker (thinker_t* thinker)
+{
+    thinker->next->prev = thinker->prev;
+    thinker->prev->next = thinker->next;
+    thinker->cnext->cprev = thinker->cprev;
+    thinker->cprev->cnext = thinker->cnext;
 }
 
 
@@ -92,12 +149,154 @@ void P_AllocateThinker (thinker_t*	thinker)
 
 
 
+// [AP] Playsim profile. While enabled, the time spent in each stage of
+// P_Ticker and in each kind of thinker is accumulated here.
+
+boolean p_profile = false;
+
+typedef struct
+{
+    const char *name;
+    actionf_p1 func;
+    uint64_t time;
+    unsigned int calls;
+} profile_entry_t;
+
+enum
+{
+    PROF_PLAYERTHINK,
+    PROF_FIRSTTHINKER,
+    PROF_OTHERTHINKER = PROF_FIRSTTHINKER + 9,
+    PROF_MUSINFO,
+    PROF_UPDATESPECIALS,
+    PROF_RESPAWNSPECIALS,
+    NUMPROFILEENTRIES
+};
+
+static profile_entry_t profile[NUMPROFILEENTRIES] =
+{
+    {"P_PlayerThink",     NULL},
+    {"P_MobjThinker",     (actionf_p1) P_MobjThinker},
+    {"T_MoveCeiling",     (actionf_p1) T_MoveCeiling},
+    {"T_MoveFloor",       (actionf_p1) T_MoveFloor},
+    {"T_VerticalDoor",    (actionf_p1) T_VerticalDoor},
+    {"T_PlatRaise",       (actionf_p1) T_PlatRaise},
+    {"T_LightFlash",      (actionf_p1) T_LightFlash},
+    {"T_StrobeFlash",     (actionf_p1) T_StrobeFlash},
+    {"T_Glow",            (actionf_p1) T_Glow},
+    {"T_FireFlicker",     (actionf_p1) T_FireFlicker},
+    {"other thinkers",    NULL},
+    {"T_MusInfo",         NULL},
+    {"P_UpdateSpecials",  NULL},
+    {"P_RespawnSpecials", NULL},
+};
+
+static uint64_t profile_start;
+static int profile_tics;
+static int peak_thinkers;
+static int peak_classes[NUMTHINKERCLASSES];
+
+void P_StartProfile (void)
+{
+    int i;
+
+    for (i = 0; i < NUMPROFILEENTRIES; i++)
+    {
+        profile[i].time = 0;
+        profile[i].calls = 0;
+    }
+
+    peak_thinkers = 0;
+    memset(peak_classes, 0, sizeof(peak_classes));
+    profile_tics = 0;
+    profile_start = I_GetTimeUS();
+    p_profile = true;
+}
+
+void P_PrintProfile (void)
+{
+    uint64_t elapsed, total;
+    int tics = profile_tics;
+    int i;
+
+    elapsed = I_GetTimeUS() - profile_start;
+    total = 0;
+
+    for (i = 0; i < NUMPROFILEENTRIES; i++)
+    {
+        total += profile[i].time;
+    }
+
+    printf("P_PrintProfile: %d tics in %.3f s (%.1f tics/s)\n",
+           tics, elapsed / 1000000.0,
+           elapsed > 0 ? tics * 1000000.0 / elapsed : 0.0);
+    printf("  playsim: %.3f s (%.1f tics/s), peak thinkers: %d "
+           "(%d mobjs, %d movers, %d lights)\n",
+           total / 1000000.0,
+           total > 0 ? tics * 1000000.0 / total : 0.0,
+           peak_thinkers, peak_classes[th_mobj],
+           peak_classes[th_mover], peak_classes[th_light]);
+    printf("  %-18s %10s %12s %10s %7s\n",
+           "function", "calls", "total ms", "us/call", "share");
+
+    for (i = 0; i < NUMPROFILEENTRIES; i++)
+    {
+        if (profile[i].calls == 0)
+        {
+            continue;
+        }
+
+        printf("  %-18s %10u %12.3f %10.3f %6.1f%%\n",
+               profile[i].name, profile[i].calls,
+               profile[i].time / 1000.0,
+               (double) profile[i].time / profile[i].calls,
+               total > 0 ? profile[i].time * 100.0 / total : 0.0);
+    }
+}
+
+// Calls are timed in place, between ProfileStart and ProfileCall; both
+// do nothing while the profile is not running.
+
+static uint64_t ProfileStart (void)
+{
+    return p_profile ? I_GetTimeUS() : 0;
+}
+
+static void ProfileCall (int entry, uint64_t start)
+{
+    if (!p_profile)
+    {
+	return;
+    }
+
+    profile[entry].time += I_GetTimeUS() - start;
+    ++profile[entry].calls;
+}
+
+static int ProfileEntryForThinker (actionf_p1 func)
+{
+    int i;
+
+    for (i = PROF_FIRSTTHINKER; i < PROF_OTHERTHINKER; i++)
+    {
+        if (profile[i].func == func)
+        {
+            return i;
+        }
+    }
+
+    return PROF_OTHERTHINKER;
+}
+
 //
 // P_RunThinkers
 //
 void P_RunThinkers (void)
 {
     thinker_t *currentthinker, *nextthinker;
+    uint64_t start;
+    int count = 0;
+    int classes[NUMTHINKERCLASSES] = {0};
 
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
@@ -106,21 +305,45 @@ void P_RunThinkers (void)
 	{
 	    // time to remove it
             nextthinker = currentthinker->next;
-	    currentthinker->next->prev = currentthinker->prev;
-	    currentthinker->prev->next = currentthinker->next;
+	    P_UnlinkThinker(currentthinker);
 	    Z_Free(currentthinker);
 	}
 	else
 	{
+	    // [AP]
+	    if (p_profile)
+	    {
+		++count;
+		++classes[P_ThinkerClass(currentthinker)];
+	    }
+
 	    if (currentthinker->function.acp1)
-		currentthinker->function.acp1 (currentthinker);
+	    {
+		actionf_p1 func = currentthinker->function.acp1;
+
+		start = ProfileStart();
+		func (currentthinker);
+
+		if (p_profile)
+		{
+		    ProfileCall(ProfileEntryForThinker(func), start);
+		}
+	    }
             nextthinker = currentthinker->next;
 	}
 	currentthinker = nextthinker;
     }
 
+    if (count > peak_thinkers)
+    {
+	peak_thinkers = count;
+	memcpy(peak_classes, classes, sizeof(peak_classes));
+    }
+
     // [crispy] support MUSINFO lump (dynamic music changing)
+    start = ProfileStart();
     T_MusInfo();
+    ProfileCall(PROF_MUSINFO, start);
 }
 
 
@@ -132,7 +355,11 @@ void P_RunThinkers (void)
 void P_Ticker (void)
 {
     int		i;
+    uint64_t	start;
     
+    // [AP] pick up the REJECT matrix once it has been generated
+    P_UpdateGeneratedReject();
+
     // run the tic
     if (paused)
 	return;
@@ -149,11 +376,27 @@ void P_Ticker (void)
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
+	{
+	    start = ProfileStart();
 	    P_PlayerThink (&players[i]);
+	    ProfileCall(PROF_PLAYERTHINK, start);
+	}
 			
     P_RunThinkers ();
+
+    start = ProfileStart();
     P_UpdateSpecials ();
+    ProfileCall(PROF_UPDATESPECIALS, start);
+
+    start = ProfileStart();
     P_RespawnSpecials ();
+    ProfileCall(PROF_RESPAWNSPECIALS, start);
+
+    // [AP]
+    if (p_profile)
+    {
+	++profile_tics;
+    }
 
     // for par times
     leveltime++;	
@@ -31,4 +31,10 @@ void P_Ticker (void);
 
 extern int init_thinkers_count;
 
+// [AP] Playsim profile (-headless): P_StartProfile resets and enables it,
+// P_PrintProfile prints tics/s, peak thinker count and per-function times.
+extern boolean p_profile;
+void P_StartProfile (void);
+void P_PrintProfile (void);
+
 #endif
@@ -613,6 +613,8 @@ R_GetColumn
 
   if (!texturecomposite2[tex])
     R_GenerateComposite(tex);
+  else
+    Z_Touch(texturecomposite2[tex]); // [AP] keep it in the cache
 
   return texturecomposite2[tex] + ofs;
 }
@@ -645,6 +647,8 @@ R_GetColumnMasked
 
     if (!texturecomposite[tex])
 	R_GenerateComposite (tex);
+    else
+	Z_Touch(texturecomposite[tex]); // [AP] keep it in the cache
 
     return texturecomposite[tex] + ofs;
 }
@@ -1508,7 +1512,7 @@ void R_PrecacheLevel (void)
     spritepresent = Z_Malloc(numsprites, PU_STATIC, NULL);
     memset (spritepresent,0, numsprites);
 	
-    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    for (th = thinkerclasscap[th_mobj].cnext ; th != &thinkerclasscap[th_mobj] ; th=th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 	    spritepresent[((mobj_t *)th)->sprite] = 1;
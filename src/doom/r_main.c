@@ -288,18 +288,13 @@ R_PointOnSegSide
 
 
 
-// [crispy] turned into a general R_PointToAngle() flavor
-// called with either slope_div = SlopeDivCrispy() from R_PointToAngleCrispy()
-// or slope_div = SlopeDiv() else
-angle_t
-R_PointToAngleSlope
+// [AP] split off R_PointToAngleSlope(), takes the deltas from the origin
+static angle_t
+R_DeltaToAngleSlope
 ( fixed_t	x,
   fixed_t	y,
   int (*slope_div) (unsigned int num, unsigned int den))
 {	
-    x -= viewx;
-    y -= viewy;
-    
     if ( (!x) && (!y) )
 	return 0;
 
@@ -377,6 +372,18 @@ R_PointToAngleSlope
     return 0;
 }
 
+// [crispy] turned into a general R_PointToAngle() flavor
+// called with either slope_div = SlopeDivCrispy() from R_PointToAngleCrispy()
+// or slope_div = SlopeDiv() else
+angle_t
+R_PointToAngleSlope
+( fixed_t	x,
+  fixed_t	y,
+  int (*slope_div) (unsigned int num, unsigned int den))
+{
+    return R_DeltaToAngleSlope (x - viewx, y - viewy, slope_div);
+}
+
 angle_t
 R_PointToAngle
 ( fixed_t	x,
@@ -386,7 +393,7 @@ R_PointToAngle
 }
 
 // [crispy] overflow-safe R_PointToAngle() flavor
-// called only from R_CheckBBox(), R_AddLine() and P_SegLengths()
+// called only from R_CheckBBox() and R_AddLine()
 angle_t
 R_PointToAngleCrispy
 ( fixed_t	x,
@@ -408,6 +415,29 @@ R_PointToAngleCrispy
     return R_PointToAngleSlope (x, y, SlopeDivCrispy);
 }
 
+// [AP] R_PointToAngleCrispy() from a given origin rather than the view,
+// so that it can be called from worker threads
+angle_t
+R_PointToAngleCrispy2
+( fixed_t	x1,
+  fixed_t	y1,
+  fixed_t	x2,
+  fixed_t	y2 )
+{
+    int64_t dx = (int64_t)x2 - x1;
+    int64_t dy = (int64_t)y2 - y1;
+
+    // [crispy] preserving the angle by halfing the distance in both directions
+    if (dx < INT_MIN || dx > INT_MAX ||
+        dy < INT_MIN || dy > INT_MAX)
+    {
+	dx /= 2;
+	dy /= 2;
+    }
+
+    return R_DeltaToAngleSlope (dx, dy, SlopeDivCrispy);
+}
+
 angle_t
 R_PointToAngle2
 ( fixed_t	x1,
@@ -130,6 +130,13 @@ R_PointToAngleCrispy
 ( fixed_t	x,
   fixed_t	y );
 
+angle_t
+R_PointToAngleCrispy2
+( fixed_t	x1,
+  fixed_t	y1,
+  fixed_t	x2,
+  fixed_t	y2 );
+
 angle_t
 R_PointToAngle2
 ( fixed_t	x1,
@@ -324,6 +324,12 @@ void S_Init(int sfxVolume, int musicVolume)
     // (the maximum numer of sounds rendered
     // simultaneously) within zone memory.
     // [crispy] variable number of sound channels
+    // [AP] no more than the sound device can play at once
+    if (snd_channels > snd_maxchannels)
+    {
+        snd_channels = snd_maxchannels;
+    }
+
     channels = I_Realloc(NULL, snd_channels*sizeof(channel_t));
     sobjs = I_Realloc(NULL, snd_channels*sizeof(degenmobj_t));
 
@@ -1290,13 +1296,14 @@ void S_UpdateSndChannels (int choice)
 		snd_channels >>= 1;
 	}
 
-	if (snd_channels > 32)
+	// [AP] up to what the sound device can play at once
+	if (snd_channels > snd_maxchannels)
 	{
 		snd_channels = 8;
 	}
 	else if (snd_channels < 8)
 	{
-		snd_channels = 32;
+		snd_channels = snd_maxchannels;
 	}
 
 	channels = I_Realloc(channels, snd_channels * sizeof(channel_t));
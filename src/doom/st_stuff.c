@@ -38,6 +38,7 @@
 #include "doomkeys.h"
 
 #include "g_game.h"
+#include "hu_stuff.h" // [AP] hu_zonestats
 #include "a11y.h" // [crispy] A11Y
 
 #include "st_stuff.h"
@@ -378,6 +379,7 @@ cheatseq_t cheat_goobers = CHEAT("goobers", 0);
 cheatseq_t cheat_version = CHEAT("version", 0); // [crispy] Russian Doom
 cheatseq_t cheat_skill = CHEAT("skill", 0);
 cheatseq_t cheat_snow = CHEAT("letitsnow", 0);
+cheatseq_t cheat_zone = CHEAT("idzone", 0); // [AP] zone statistics
 
 // [AP] new cheats
 cheatseq_t cheat_key[2] = 
@@ -494,7 +496,7 @@ static int ST_cheat_massacre()
     extern int numbraintargets;
     extern void A_PainDie(mobj_t *);
 
-    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
     {
 	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 	{
@@ -943,7 +945,7 @@ ST_Responder (event_t* ev)
 		thinker_t *th;
 
 		// [crispy] let mobjs forget their target and tracer
-		for (th = thinkercap.next; th != &thinkercap; th = th->next)
+		for (th = thinkerclasscap[th_mobj].cnext; th != &thinkerclasscap[th_mobj]; th = th->cnext)
 		{
 			if (th->function.acp1 == (actionf_p1)P_MobjThinker)
 			{
@@ -1105,6 +1107,11 @@ ST_Responder (event_t* ev)
     {
 	plyr->powers[pw_showfps] ^= 1;
     }
+    // [AP] zone allocator statistics page
+    else if (cht_CheckCheat(&cheat_zone, ev->data2))
+    {
+	hu_zonestats = !hu_zonestats;
+    }
     // [crispy] implement Boom's "tnthom" cheat
     else if (cht_CheckCheat(&cheat_hom, ev->data2))
     {
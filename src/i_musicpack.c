@@ -140,6 +140,35 @@ static Mix_Music *current_track_music = NULL;
 // If true, the currently playing track is being played on loop.
 static boolean current_track_loop;
 
+// [AP] Substitute tracks are read on a background thread, so that song
+// changes never wait on the disk. The whole file is read ahead into
+// memory with large reads and decoded from there, so playback does not
+// touch the disk either; only files larger than this are streamed from
+// disk by SDL_mixer. SDL_mixer itself is only ever called from the main
+// thread, which opens the track once the read has finished.
+#define MAX_READAHEAD_SIZE (128 * 1024 * 1024)
+
+typedef struct
+{
+    char *filename;
+    SDL_Thread *loader;
+    SDL_atomic_t ready;
+
+    byte *filedata;
+    long filelen;
+    boolean opened;
+    Mix_Music *music;
+#if !USE_SDL_MIXER_LOOPING
+    file_metadata_t metadata;
+#endif
+} mp_song_t;
+
+// Song passed to the last PlaySong call, and whether it is still waiting
+// for its loader thread before it can start.
+static mp_song_t *current_song = NULL;
+static boolean current_song_pending = false;
+static boolean music_paused = false;
+
 // Table of known hashes and filenames to look up for them. This allows
 // users to drop in a set of files without having to also provide a
 // configuration file.
@@ -1207,26 +1236,108 @@ static void I_MP_SetMusicVolume(int volume)
     Mix_VolumeMusic((volume * MIX_MAX_VOLUME) / 127);
 }
 
-// Start playing a mid
+// [AP] Runs on the song's loader thread. Only reads the file; it must
+// not call into SDL_mixer.
 
-static void I_MP_PlaySong(void *handle, boolean looping)
+static int SongLoaderThread(void *arg)
 {
-    int loops;
+    mp_song_t *song = arg;
+    FILE *fs;
+    long len = 0;
 
-    if (!music_initialized)
+    fs = M_fopen(song->filename, "rb");
+
+    if (fs != NULL)
+    {
+        len = M_FileLength(fs);
+
+        if (len > 0 && len <= MAX_READAHEAD_SIZE)
+        {
+            song->filedata = malloc(len);
+
+            if (song->filedata != NULL
+             && fread(song->filedata, 1, len, fs) != len)
+            {
+                free(song->filedata);
+                song->filedata = NULL;
+            }
+        }
+
+        fclose(fs);
+    }
+
+    song->filelen = len;
+
+#if !USE_SDL_MIXER_LOOPING
+    // Read loop point metadata from the file so that we know where
+    // to loop the music.
+    ReadLoopPoints(song->filename, &song->metadata);
+#endif // !USE_SDL_MIXER_LOOPING
+
+    SDL_AtomicSet(&song->ready, 1);
+
+    return 0;
+}
+
+// [AP] Block until a song's loader thread has finished.
+
+static void WaitForSong(mp_song_t *song)
+{
+    if (song->loader != NULL)
+    {
+        SDL_WaitThread(song->loader, NULL);
+        song->loader = NULL;
+    }
+}
+
+// [AP] Open a song whose file has been read, on the main thread.
+
+static void OpenSong(mp_song_t *song)
+{
+    WaitForSong(song);
+
+    if (song->opened)
     {
         return;
     }
 
-    if (handle == NULL)
+    song->opened = true;
+
+    if (song->filedata != NULL)
+    {
+        song->music = Mix_LoadMUS_RW(SDL_RWFromConstMem(song->filedata,
+                                                        song->filelen), 1);
+    }
+    else
+    {
+        song->music = Mix_LoadMUS(song->filename);
+    }
+
+    if (song->music == NULL)
+    {
+        fprintf(stderr, "Failed to load substitute music file: %s: %s\n",
+                song->filename, Mix_GetError());
+    }
+}
+
+// Start playing a song that has finished loading.
+
+static void StartSong(mp_song_t *song)
+{
+    int loops;
+
+    current_song_pending = false;
+
+    OpenSong(song);
+
+    if (song->music == NULL)
     {
         return;
     }
 
-    current_track_music = (Mix_Music *) handle;
-    current_track_loop = looping;
+    current_track_music = song->music;
 
-    if (looping)
+    if (current_track_loop)
     {
         loops = -1;
     }
@@ -1236,6 +1347,8 @@ static void I_MP_PlaySong(void *handle, boolean looping)
     }
 
 #if !USE_SDL_MIXER_LOOPING
+    file_metadata = song->metadata;
+
     // Don't loop when playing substitute music, as we do it
     // ourselves instead.
     if (file_metadata.valid)
@@ -1252,6 +1365,41 @@ static void I_MP_PlaySong(void *handle, boolean looping)
         fprintf(stderr, "I_MP_PlaySong: Error starting track: %s\n",
                 Mix_GetError());
     }
+    else if (music_paused)
+    {
+        Mix_PauseMusic();
+    }
+}
+
+// Start playing a mid
+
+static void I_MP_PlaySong(void *handle, boolean looping)
+{
+    mp_song_t *song = (mp_song_t *) handle;
+
+    if (!music_initialized)
+    {
+        return;
+    }
+
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    current_song = song;
+    current_track_loop = looping;
+
+    // If the song is still loading, I_MP_PollMusic starts it later.
+
+    if (SDL_AtomicGet(&song->ready))
+    {
+        StartSong(song);
+    }
+    else
+    {
+        current_song_pending = true;
+    }
 }
 
 static void I_MP_PauseSong(void)
@@ -1261,6 +1409,7 @@ static void I_MP_PauseSong(void)
         return;
     }
 
+    music_paused = true;
     Mix_PauseMusic();
 }
 
@@ -1271,6 +1420,7 @@ static void I_MP_ResumeSong(void)
         return;
     }
 
+    music_paused = false;
     Mix_ResumeMusic();
 }
 
@@ -1283,11 +1433,12 @@ static void I_MP_StopSong(void)
 
     Mix_HaltMusic();
     current_track_music = NULL;
+    current_song_pending = false;
 }
 
 static void I_MP_UnRegisterSong(void *handle)
 {
-    Mix_Music *music = (Mix_Music *) handle;
+    mp_song_t *song = (mp_song_t *) handle;
 
     if (!music_initialized)
     {
@@ -1299,13 +1450,28 @@ static void I_MP_UnRegisterSong(void *handle)
         return;
     }
 
-    Mix_FreeMusic(music);
+    WaitForSong(song);
+
+    if (song == current_song)
+    {
+        current_song = NULL;
+        current_song_pending = false;
+    }
+
+    if (song->music != NULL)
+    {
+        Mix_FreeMusic(song->music);
+    }
+
+    free(song->filedata);
+    free(song->filename);
+    free(song);
 }
 
 static void *I_MP_RegisterSong(void *data, int len)
 {
     const char *filename;
-    Mix_Music *music;
+    mp_song_t *song;
 
     if (!music_initialized)
     {
@@ -1319,22 +1485,27 @@ static void *I_MP_RegisterSong(void *data, int len)
         return NULL;
     }
 
-    music = Mix_LoadMUS(filename);
-    if (music == NULL)
+    // [AP] The file is read asynchronously, so we can only fall back
+    // to normal MIDI playback here if the file is missing altogether.
+    if (!M_FileExists(filename))
     {
-        // Fall through and play MIDI normally, but print an error
-        // message.
-        fprintf(stderr, "Failed to load substitute music file: %s: %s\n",
-                filename, Mix_GetError());
+        fprintf(stderr, "Failed to load substitute music file: %s\n",
+                filename);
         return NULL;
     }
 
-#if !USE_SDL_MIXER_LOOPING
-    // Read loop point metadata from the file so that we know where
-    // to loop the music.
-    ReadLoopPoints(filename, &file_metadata);
-#endif // !USE_SDL_MIXER_LOOPING
-    return music;
+    song = calloc(1, sizeof(mp_song_t));
+    song->filename = M_StringDuplicate(filename);
+    SDL_AtomicSet(&song->ready, 0);
+
+    song->loader = SDL_CreateThread(SongLoaderThread, "music loader", song);
+
+    if (song->loader == NULL)
+    {
+        SongLoaderThread(song);
+    }
+
+    return song;
 }
 
 // Is the song playing?
@@ -1345,7 +1516,7 @@ static boolean I_MP_MusicIsPlaying(void)
         return false;
     }
 
-    return Mix_PlayingMusic();
+    return current_song_pending || Mix_PlayingMusic();
 }
 
 #if !USE_SDL_MIXER_LOOPING
@@ -1386,6 +1557,12 @@ static void RestartCurrentTrack(void)
 // then we need to go back.
 static void I_MP_PollMusic(void)
 {
+    // [AP] Start the current song once its loader thread is done.
+    if (current_song_pending && SDL_AtomicGet(&current_song->ready))
+    {
+        StartSong(current_song);
+    }
+
 #if !USE_SDL_MIXER_LOOPING
     // When playing substitute tracks, loop tags only apply if we're playing
     // a looping track. Tracks like the title screen music have the loop
@@ -320,8 +320,24 @@ static char (*percussion_names)[32];
 static opl_voice_t voices[OPL_NUM_VOICES * 2];
 static opl_voice_t *voice_free_list[OPL_NUM_VOICES * 2];
 static opl_voice_t *voice_alloced_list[OPL_NUM_VOICES * 2];
+static int voice_free_head;
 static int voice_free_num;
 static int voice_alloced_num;
+
+// [AP] The free list is a FIFO, so it is kept as a ring buffer starting
+// at voice_free_head rather than being shifted down on every allocation.
+// The allocated list keeps its order, as the vanilla voice stealing
+// rules depend on it.
+//
+// To avoid walking the allocated list for every event, we also keep
+// bitmasks (bit n = voices[n]) of the voices allocated to each channel
+// and to each channel/key pair. A set bit only means the list has to be
+// searched; an empty mask means there is nothing to find.
+
+#define VOICE_BIT(voice) (1u << ((voice) - voices))
+
+static uint32_t channel_voice_mask[MIDI_CHANNELS_PER_TRACK];
+static uint32_t key_voice_mask[MIDI_CHANNELS_PER_TRACK][128];
 static int opl_opl3mode;
 static int num_opl_voices;
 
@@ -382,7 +398,6 @@ static boolean LoadInstrumentTable(void)
 static opl_voice_t *GetFreeVoice(void)
 {
     opl_voice_t *result;
-    int i;
 
     // None available?
 
@@ -393,15 +408,11 @@ static opl_voice_t *GetFreeVoice(void)
 
     // Remove from free list
 
-    result = voice_free_list[0];
+    result = voice_free_list[voice_free_head];
 
+    voice_free_head = (voice_free_head + 1) % arrlen(voice_free_list);
     voice_free_num--;
 
-    for (i = 0; i < voice_free_num; i++)
-    {
-        voice_free_list[i] = voice_free_list[i + 1];
-    }
-
     // Add to allocated list
 
     voice_alloced_list[voice_alloced_num++] = result;
@@ -432,6 +443,10 @@ static void ReleaseVoice(int index)
 
     VoiceKeyOff(voice);
 
+    channel_voice_mask[voice->channel - channels] &= ~VOICE_BIT(voice);
+    key_voice_mask[voice->channel - channels][voice->key & 0x7f]
+        &= ~VOICE_BIT(voice);
+
     voice->channel = NULL;
     voice->note = 0;
 
@@ -448,7 +463,9 @@ static void ReleaseVoice(int index)
 
     // Search to the end of the freelist (This is how Doom behaves!)
 
-    voice_free_list[voice_free_num++] = voice;
+    voice_free_list[(voice_free_head + voice_free_num) % arrlen(voice_free_list)]
+        = voice;
+    voice_free_num++;
 
     if (double_voice && opl_drv_ver < opl_doom_1_9)
     {
@@ -610,9 +627,13 @@ static void InitVoices(void)
 
     // Start with an empty free list.
     
+    voice_free_head = 0;
     voice_free_num = num_opl_voices;
     voice_alloced_num = 0;
 
+    memset(channel_voice_mask, 0, sizeof(channel_voice_mask));
+    memset(key_voice_mask, 0, sizeof(key_voice_mask));
+
     // Initialize each voice.
 
     for (i = 0; i < num_opl_voices; ++i)
@@ -706,6 +727,11 @@ static void KeyOffEvent(opl_track_data_t *track, midi_event_t *event)
     channel = TrackChannelForEvent(track, event);
     key = event->data.channel.param1;
 
+    if (key_voice_mask[channel - channels][key & 0x7f] == 0)
+    {
+        return;
+    }
+
     // Turn off voices being used to play this key.
     // If it is a double voice instrument there will be two.
 
@@ -930,6 +956,9 @@ static void VoiceKeyOn(opl_channel_data_t *channel,
     voice->channel = channel;
     voice->key = key;
 
+    channel_voice_mask[channel - channels] |= VOICE_BIT(voice);
+    key_voice_mask[channel - channels][key & 0x7f] |= VOICE_BIT(voice);
+
     // Work out the note to use.  This is normally the same as
     // the key, unless it is a fixed pitch instrument.
 
@@ -1165,6 +1194,11 @@ static void AllNotesOff(opl_channel_data_t *channel, unsigned int param)
 {
     int i;
 
+    if (channel_voice_mask[channel - channels] == 0)
+    {
+        return;
+    }
+
     for (i = 0; i < voice_alloced_num; i++)
     {
         if (voice_alloced_list[i]->channel == channel)
@@ -1234,6 +1268,13 @@ static void PitchBendEvent(opl_track_data_t *track, midi_event_t *event)
     channel = TrackChannelForEvent(track, event);
     channel->bend = event->data.channel.param2 - 64;
 
+    // Nothing to update, and the list would be reordered unchanged.
+
+    if (channel_voice_mask[channel - channels] == 0)
+    {
+        return;
+    }
+
     // Update all voices for this channel.
 
 	for (i = 0; i < voice_alloced_num; ++i)
@@ -1819,6 +1860,11 @@ static int ChannelInUse(opl_channel_data_t *channel)
 {
     int i;
 
+    if (channel_voice_mask[channel - channels] == 0)
+    {
+        return 0;
+    }
+
     for (i = 0; i < voice_alloced_num; i++)
     {
         if (voice_alloced_list[i]->channel == channel)
@@ -1890,3 +1936,310 @@ void I_OPL_DevMessages(char *result, size_t result_len)
     } while (lines < 25 && i != last_perc_count);
 }
 
+
+#ifdef OPLRENDER
+
+// [AP] Offline render tool: plays every music lump in a WAD through the
+// OPL emulator as fast as possible, writing each one out as a WAV file
+// and reporting the synthesis throughput.  Build with ENABLE_EXTRA_TOOLS.
+
+#include "SDL.h"
+
+#include "i_system.h"
+#include "m_argv.h"
+
+#define RENDER_CHUNK    1024    // frames per OPL_Render() call
+#define RENDER_TAIL_MS  1000    // keep rendering after the song ends
+
+typedef PACKED_STRUCT (
+{
+    char identification[4];
+    int numlumps;
+    int infotableofs;
+}) render_wadinfo_t;
+
+typedef PACKED_STRUCT (
+{
+    int filepos;
+    int size;
+    char name[8];
+}) render_filelump_t;
+
+int snd_samplerate = 44100;
+
+static byte *render_wad;
+static int render_wad_len;
+static render_filelump_t *render_lumps;
+static int render_numlumps;
+
+boolean IsMid(byte *mem, int len)
+{
+    return len > 4 && !memcmp(mem, "MThd", 4);
+}
+
+boolean IsMus(byte *mem, int len)
+{
+    return len > 4 && !memcmp(mem, "MUS\x1a", 4);
+}
+
+// Just enough of the WAD interface for LoadInstrumentTable().
+
+void *W_CacheLumpName(const char *name, int tag)
+{
+    int i;
+
+    for (i = render_numlumps - 1; i >= 0; --i)
+    {
+        if (!strncasecmp(render_lumps[i].name, name, 8))
+        {
+            return render_wad + LONG(render_lumps[i].filepos);
+        }
+    }
+
+    I_Error("W_CacheLumpName: %s not found!", name);
+
+    return NULL;
+}
+
+void W_ReleaseLumpName(const char *name)
+{
+}
+
+static void LoadWAD(const char *filename)
+{
+    render_wadinfo_t *header;
+    int i;
+
+    render_wad_len = M_ReadFile(filename, &render_wad);
+    header = (render_wadinfo_t *) render_wad;
+
+    if (render_wad_len < sizeof(render_wadinfo_t)
+     || (strncmp(header->identification, "IWAD", 4)
+      && strncmp(header->identification, "PWAD", 4)))
+    {
+        I_Error("LoadWAD: %s is not a WAD file", filename);
+    }
+
+    render_numlumps = LONG(header->numlumps);
+    render_lumps = (render_filelump_t *)
+                   (render_wad + LONG(header->infotableofs));
+
+    if (LONG(header->infotableofs) + render_numlumps
+                                   * sizeof(render_filelump_t)
+        > render_wad_len)
+    {
+        I_Error("LoadWAD: %s has a truncated directory", filename);
+    }
+
+    for (i = 0; i < render_numlumps; ++i)
+    {
+        if (LONG(render_lumps[i].filepos) + LONG(render_lumps[i].size)
+            > render_wad_len)
+        {
+            I_Error("LoadWAD: lump %i runs past the end of %s", i, filename);
+        }
+    }
+}
+
+static void WriteWAVHeader(FILE *wav, uint32_t length, int samplerate)
+{
+    unsigned int i;
+    unsigned short s;
+
+    fwrite("RIFF", 1, 4, wav);
+    i = LONG(36 + length);
+    fwrite(&i, 4, 1, wav);
+    fwrite("WAVE", 1, 4, wav);
+
+    fwrite("fmt ", 1, 4, wav);
+    i = LONG(16);
+    fwrite(&i, 4, 1, wav);           // Length
+    s = SHORT(1);
+    fwrite(&s, 2, 1, wav);           // Format (PCM)
+    s = SHORT(2);
+    fwrite(&s, 2, 1, wav);           // Channels (2=stereo)
+    i = LONG(samplerate);
+    fwrite(&i, 4, 1, wav);           // Sample rate
+    i = LONG(samplerate * 2 * 2);
+    fwrite(&i, 4, 1, wav);           // Byte rate (samplerate * stereo * 16 bit)
+    s = SHORT(2 * 2);
+    fwrite(&s, 2, 1, wav);           // Block align (stereo * 16 bit)
+    s = SHORT(16);
+    fwrite(&s, 2, 1, wav);           // Bits per sample (16 bit)
+
+    fwrite("data", 1, 4, wav);
+    i = LONG(length);
+    fwrite(&i, 4, 1, wav);           // Data length
+}
+
+// Render one song until it ends (or hits max_frames) and return the
+// number of frames generated.
+
+static uint64_t RenderSong(void *handle, FILE *wav, uint64_t max_frames)
+{
+    int16_t buffer[RENDER_CHUNK * 2];
+    uint64_t frames = 0;
+    uint64_t tail_frames = 0;
+    uint64_t max_tail;
+    unsigned int i;
+
+    max_tail = ((uint64_t) snd_samplerate * RENDER_TAIL_MS) / 1000;
+
+    I_OPL_PlaySong(handle, false);
+
+    while (frames < max_frames && tail_frames < max_tail)
+    {
+        OPL_Render(buffer, RENDER_CHUNK);
+        frames += RENDER_CHUNK;
+
+        if (running_tracks == 0)
+        {
+            tail_frames += RENDER_CHUNK;
+        }
+
+        if (wav != NULL)
+        {
+            for (i = 0; i < RENDER_CHUNK * 2; ++i)
+            {
+                buffer[i] = SHORT(buffer[i]);
+            }
+
+            fwrite(buffer, 4, RENDER_CHUNK, wav);
+        }
+    }
+
+    I_OPL_StopSong();
+
+    return frames;
+}
+
+int main(int argc, char *argv[])
+{
+    char name[9], *filename;
+    const char *outdir;
+    FILE *wav;
+    void *handle;
+    byte *data;
+    uint64_t frames, max_frames, total_frames = 0;
+    uint64_t start, elapsed, total_elapsed = 0;
+    int songs = 0;
+    int len, i, p;
+
+    myargc = argc;
+    myargv = argv;
+
+    if (argc < 2)
+    {
+        printf("Usage: %s <wadfile> [-output <dir>] [-samplerate <rate>]\n"
+               "          [-maxlen <seconds>] [-nowav]\n", argv[0]);
+        exit(-1);
+    }
+
+    Z_Init();
+    LoadWAD(argv[1]);
+
+    outdir = ".";
+    p = M_CheckParmWithArgs("-output", 1);
+    if (p > 0)
+    {
+        outdir = myargv[p + 1];
+    }
+
+    p = M_CheckParmWithArgs("-samplerate", 1);
+    if (p > 0)
+    {
+        snd_samplerate = atoi(myargv[p + 1]);
+    }
+
+    max_frames = (uint64_t) snd_samplerate * 600;
+    p = M_CheckParmWithArgs("-maxlen", 1);
+    if (p > 0)
+    {
+        max_frames = (uint64_t) snd_samplerate * atoi(myargv[p + 1]);
+    }
+
+    putenv("OPL_DRIVER=render");
+
+    if (!I_OPL_InitMusic())
+    {
+        fprintf(stderr, "Failed to initialize OPL emulation.\n");
+        exit(-1);
+    }
+
+    I_OPL_SetMusicVolume(127);
+
+    for (i = 0; i < render_numlumps; ++i)
+    {
+        data = render_wad + LONG(render_lumps[i].filepos);
+        len = LONG(render_lumps[i].size);
+
+        if (!IsMus(data, len) && !IsMid(data, len))
+        {
+            continue;
+        }
+
+        memcpy(name, render_lumps[i].name, 8);
+        name[8] = '\0';
+        M_ForceLowercase(name);
+
+        handle = I_OPL_RegisterSong(data, len);
+        if (handle == NULL)
+        {
+            fprintf(stderr, "%s: failed to load, skipping.\n", name);
+            continue;
+        }
+
+        wav = NULL;
+        filename = NULL;
+
+        if (!M_ParmExists("-nowav"))
+        {
+            filename = M_StringJoin(outdir, DIR_SEPARATOR_S, name, ".wav",
+                                    NULL);
+            wav = M_fopen(filename, "wb");
+
+            if (wav == NULL)
+            {
+                I_Error("Failed to open %s for writing", filename);
+            }
+
+            WriteWAVHeader(wav, 0, snd_samplerate);
+        }
+
+        start = SDL_GetPerformanceCounter();
+        frames = RenderSong(handle, wav, max_frames);
+        elapsed = SDL_GetPerformanceCounter() - start;
+
+        if (wav != NULL)
+        {
+            rewind(wav);
+            WriteWAVHeader(wav, frames * 4, snd_samplerate);
+            fclose(wav);
+            free(filename);
+        }
+
+        I_OPL_UnRegisterSong(handle);
+
+        printf("%-8s %8.1fs %12.0f samples/sec %8.1fx realtime\n",
+               name, (double) frames / snd_samplerate,
+               (double) frames * SDL_GetPerformanceFrequency()
+                   / (elapsed ? elapsed : 1),
+               (double) frames * SDL_GetPerformanceFrequency()
+                   / (elapsed ? elapsed : 1) / snd_samplerate);
+
+        total_frames += frames;
+        total_elapsed += elapsed;
+        ++songs;
+    }
+
+    printf("%i songs, %.1fs of audio, %.0f samples/sec overall\n",
+           songs, (double) total_frames / snd_samplerate,
+           (double) total_frames * SDL_GetPerformanceFrequency()
+               / (total_elapsed ? total_elapsed : 1));
+
+    I_OPL_ShutdownMusic();
+
+    return 0;
+}
+
+#endif
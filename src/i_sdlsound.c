@@ -33,8 +33,11 @@
 #include "i_sound.h"
 #include "i_system.h"
 #include "i_swap.h"
+#include "i_thread.h"
 #include "m_argv.h"
+#include "m_config.h"
 #include "m_misc.h"
+#include "sha1.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
@@ -57,6 +60,20 @@ int use_libsamplerate = 1;
 // clipping. This will also better match vanilla's volume.
 float libsamplerate_scale = 1.0f;
 
+// [AP] If non-zero, sound effects are mixed by our own software mixer
+// from SDL_mixer's post-mix hook instead of one SDL_mixer channel each.
+
+int snd_internalmixer = 0;
+
+// [AP] If non-zero, converted sound effects are cached on disk.
+
+int snd_resamplecache = 1;
+
+// [AP] The number of sound effects that can play at once, set when the
+// sound device is initialized.
+
+int snd_maxchannels = 16*2;
+
 
 #ifndef DISABLE_SDL2MIXER
 
@@ -66,6 +83,7 @@ float libsamplerate_scale = 1.0f;
 #define LOW_PASS_FILTER
 //#define DEBUG_DUMP_WAVS
 #define NUM_CHANNELS 16*2 // [crispy] support up to 32 sound channels
+#define NUM_MIX_CHANNELS 128 // [AP] with the internal mixer
 
 typedef struct allocated_sound_s allocated_sound_t;
 
@@ -80,17 +98,23 @@ struct allocated_sound_s
 
 static boolean sound_initialized = false;
 
-static allocated_sound_t *channels_playing[NUM_CHANNELS];
+static allocated_sound_t *channels_playing[NUM_MIX_CHANNELS];
 
 static int mixer_freq;
 static Uint16 mixer_format;
 static int mixer_channels;
 static boolean use_sfx_prefix;
-static boolean (*ExpandSoundData)(sfxinfo_t *sfxinfo,
-                                  byte *data,
-                                  int samplerate,
-                                  int bits,
-                                  int length) = NULL;
+static byte *(*ExpandSoundData)(sfxinfo_t *sfxinfo,
+                                byte *data,
+                                int samplerate,
+                                int bits,
+                                int length,
+                                uint32_t *expanded_length) = NULL;
+
+// [AP] Directory holding resampled sound effects from previous runs,
+// or NULL if the on-disk resample cache is not in use.
+
+static char *sfx_cache_dir = NULL;
 
 // Doubly-linked list of allocated sounds.
 // When a sound is played, it is moved to the head, so that the oldest
@@ -100,6 +124,69 @@ static allocated_sound_t *allocated_sounds_head = NULL;
 static allocated_sound_t *allocated_sounds_tail = NULL;
 static int allocated_sounds_size = 0;
 
+// [AP] Internal sound effect mixer.
+//
+// The game thread never touches the mixer state directly. Instead it
+// pushes start/stop/param commands into a single-producer single-consumer
+// ring, which the audio thread drains at the start of every mix callback.
+// A sound that was playing on a channel may still be referenced by the
+// audio thread until the command that stopped it has been consumed, so
+// released sounds are "retired" and only unlocked once that has happened.
+
+#define MIXCMD_QUEUE_SIZE 512 // must be a power of two
+#define MIX_BLOCK_FRAMES 256
+#define MIXCMD_TIMEOUT 20 // ms
+
+typedef enum
+{
+    MIXCMD_START,
+    MIXCMD_STOP,
+    MIXCMD_PARAMS,
+} mixcmd_type_t;
+
+typedef struct
+{
+    mixcmd_type_t type;
+    int channel;
+    int voice;
+    allocated_sound_t *snd;
+    float left, right;
+} mixcmd_t;
+
+typedef struct
+{
+    const Sint16 *data;
+    unsigned int length;      // in stereo frames
+    unsigned int pos;
+    int voice;
+    float left, right;
+    float target_left, target_right;
+} mixchannel_t;
+
+typedef struct
+{
+    allocated_sound_t *snd;
+    unsigned int cmd;         // queue position just after the stop command
+} retired_sound_t;
+
+static boolean use_internal_mixer = false;
+
+static mixcmd_t mixcmd_queue[MIXCMD_QUEUE_SIZE];
+static SDL_atomic_t mixcmd_head;  // written by the game thread only
+static SDL_atomic_t mixcmd_tail;  // written by the audio thread only
+
+// Audio thread only, apart from mixchannel_done which is published to
+// the game thread: the voice number that most recently finished.
+static mixchannel_t mixchannels[NUM_MIX_CHANNELS];
+static SDL_atomic_t mixchannel_done[NUM_MIX_CHANNELS];
+static float mix_buffer[MIX_BLOCK_FRAMES * 2];
+
+// Game thread only.
+static int channel_voice[NUM_MIX_CHANNELS];
+static int next_voice = 1;
+static retired_sound_t retired_sounds[MIXCMD_QUEUE_SIZE];
+static int num_retired_sounds = 0;
+
 
 // Hook a sound into the linked list at the head.
 
@@ -351,11 +438,129 @@ static allocated_sound_t * PitchShift(allocated_sound_t *insnd, int pitch)
 // we can mark the sound data as CACHE to be freed back for other
 // means.
 
+static void UnlockReleasedSound(allocated_sound_t *snd)
+{
+    UnlockAllocatedSound(snd);
+
+    // if the sound is a pitch-shift and it's not in use, immediately
+    // free it
+    if (snd->pitch != NORM_PITCH && snd->use_count <= 0)
+    {
+        FreeAllocatedSound(snd);
+    }
+}
+
+// [AP] Wait for the audio thread to make room, for at most
+// MIXCMD_TIMEOUT ms. The callback may never run again if the device is
+// lost, or if it runs on this very thread (Emscripten).
+
+static boolean WaitForMixer(boolean (*full)(void))
+{
+    Uint32 start = SDL_GetTicks();
+
+    while (full())
+    {
+        if (SDL_GetTicks() - start >= MIXCMD_TIMEOUT)
+        {
+            return false;
+        }
+
+        SDL_Delay(1);
+    }
+
+    return true;
+}
+
+static boolean MixQueueFull(void)
+{
+    return (unsigned int) SDL_AtomicGet(&mixcmd_head)
+         - (unsigned int) SDL_AtomicGet(&mixcmd_tail) >= MIXCMD_QUEUE_SIZE;
+}
+
+// [AP] Queue a command for the internal mixer. The audio thread drains
+// the whole queue on every slice, so if it is full we normally only have
+// to wait for the next callback. Returns false if the command had to be
+// dropped; parameter changes are dropped at once, as the next update
+// supersedes them anyway.
+
+static boolean PushMixCommand(const mixcmd_t *cmd)
+{
+    unsigned int head;
+
+    if (cmd->type == MIXCMD_PARAMS ? MixQueueFull()
+                                   : !WaitForMixer(MixQueueFull))
+    {
+        return false;
+    }
+
+    head = (unsigned int) SDL_AtomicGet(&mixcmd_head);
+    mixcmd_queue[head & (MIXCMD_QUEUE_SIZE - 1)] = *cmd;
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&mixcmd_head, (int) (head + 1));
+
+    return true;
+}
+
+// [AP] Unlock every retired sound whose stop command has been consumed
+// by the audio thread.
+
+static void ReapRetiredSounds(void)
+{
+    unsigned int tail;
+    int i, j;
+
+    tail = (unsigned int) SDL_AtomicGet(&mixcmd_tail);
+    SDL_MemoryBarrierAcquire();
+
+    for (i = 0, j = 0; i < num_retired_sounds; ++i)
+    {
+        if ((int) (tail - retired_sounds[i].cmd) >= 0)
+        {
+            UnlockReleasedSound(retired_sounds[i].snd);
+        }
+        else
+        {
+            retired_sounds[j++] = retired_sounds[i];
+        }
+    }
+
+    num_retired_sounds = j;
+}
+
+static boolean RetiredSoundsFull(void)
+{
+    ReapRetiredSounds();
+
+    return num_retired_sounds >= MIXCMD_QUEUE_SIZE;
+}
+
+// [AP] Keep snd locked until the audio thread has consumed the stop
+// command just queued for it. If the mixer has stopped running, the sound
+// simply stays locked: its data must not be freed under a channel that
+// might still play it.
+
+static void RetireSound(allocated_sound_t *snd)
+{
+    if (!WaitForMixer(RetiredSoundsFull))
+    {
+        return;
+    }
+
+    retired_sounds[num_retired_sounds].snd = snd;
+    retired_sounds[num_retired_sounds].cmd =
+        (unsigned int) SDL_AtomicGet(&mixcmd_head);
+    ++num_retired_sounds;
+}
+
 static void ReleaseSoundOnChannel(int channel)
 {
     allocated_sound_t *snd = channels_playing[channel];
 
-    Mix_HaltChannel(channel);
+    if (!use_internal_mixer)
+    {
+        Mix_HaltChannel(channel);
+    }
 
     if (snd == NULL)
     {
@@ -364,13 +569,168 @@ static void ReleaseSoundOnChannel(int channel)
 
     channels_playing[channel] = NULL;
 
-    UnlockAllocatedSound(snd);
+    if (use_internal_mixer)
+    {
+        mixcmd_t cmd;
 
-    // if the sound is a pitch-shift and it's not in use, immediately
-    // free it
-    if (snd->pitch != NORM_PITCH && snd->use_count <= 0)
+        cmd.type = MIXCMD_STOP;
+        cmd.channel = channel;
+        cmd.voice = channel_voice[channel];
+        cmd.snd = NULL;
+        cmd.left = cmd.right = 0.0f;
+
+        if (PushMixCommand(&cmd))
+        {
+            RetireSound(snd);
+        }
+
+        return;
+    }
+
+    UnlockReleasedSound(snd);
+}
+
+// [AP] Audio thread: apply a single queued command to the mixer state.
+
+static void ApplyMixCommand(const mixcmd_t *cmd)
+{
+    mixchannel_t *ch = &mixchannels[cmd->channel];
+
+    switch (cmd->type)
     {
-        FreeAllocatedSound(snd);
+        case MIXCMD_START:
+            if (ch->data != NULL)
+            {
+                SDL_AtomicSet(&mixchannel_done[cmd->channel], ch->voice);
+            }
+            ch->data = (const Sint16 *) cmd->snd->chunk.abuf;
+            ch->length = cmd->snd->chunk.alen / 4;
+            ch->pos = 0;
+            ch->voice = cmd->voice;
+            ch->left = ch->target_left = cmd->left;
+            ch->right = ch->target_right = cmd->right;
+            break;
+
+        case MIXCMD_STOP:
+            if (ch->data != NULL && ch->voice == cmd->voice)
+            {
+                ch->data = NULL;
+                SDL_AtomicSet(&mixchannel_done[cmd->channel], ch->voice);
+            }
+            break;
+
+        case MIXCMD_PARAMS:
+            if (ch->voice == cmd->voice)
+            {
+                ch->target_left = cmd->left;
+                ch->target_right = cmd->right;
+            }
+            break;
+    }
+}
+
+// [AP] Audio thread: mix up to MIX_BLOCK_FRAMES frames of one channel
+// into mix_buffer. Volume and separation changes are ramped linearly
+// across the block to avoid clicks. The gain is computed from the frame
+// index rather than accumulated, so that the compiler can vectorize the
+// loop.
+
+static void MixChannel(mixchannel_t *ch, int frames)
+{
+    const Sint16 *src;
+    float left, right, step_left, step_right;
+    int n, i;
+
+    n = ch->length - ch->pos;
+    if (n > frames)
+    {
+        n = frames;
+    }
+
+    src = ch->data + ch->pos * 2;
+    left = ch->left;
+    right = ch->right;
+    step_left = (ch->target_left - left) / frames;
+    step_right = (ch->target_right - right) / frames;
+
+    for (i = 0; i < n; ++i)
+    {
+        mix_buffer[i * 2] += src[i * 2] * (left + step_left * (i + 1));
+        mix_buffer[i * 2 + 1] += src[i * 2 + 1] * (right + step_right * (i + 1));
+    }
+
+    ch->left = ch->target_left;
+    ch->right = ch->target_right;
+    ch->pos += n;
+}
+
+// [AP] SDL_mixer post-mix callback: drain the command queue, then mix
+// every active channel on top of the already mixed music.
+
+static void I_SDL_MixSfx(void *udata, Uint8 *stream, int len)
+{
+    Sint16 *out = (Sint16 *) stream;
+    unsigned int head, tail;
+    int frames, block, i, c;
+
+    head = (unsigned int) SDL_AtomicGet(&mixcmd_head);
+    tail = (unsigned int) SDL_AtomicGet(&mixcmd_tail);
+    SDL_MemoryBarrierAcquire();
+
+    while (tail != head)
+    {
+        ApplyMixCommand(&mixcmd_queue[tail & (MIXCMD_QUEUE_SIZE - 1)]);
+        ++tail;
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&mixcmd_tail, (int) tail);
+
+    frames = len / 4;
+
+    while (frames > 0)
+    {
+        boolean active = false;
+
+        block = frames < MIX_BLOCK_FRAMES ? frames : MIX_BLOCK_FRAMES;
+
+        memset(mix_buffer, 0, block * 2 * sizeof(float));
+
+        for (c = 0; c < NUM_MIX_CHANNELS; ++c)
+        {
+            mixchannel_t *ch = &mixchannels[c];
+
+            if (ch->data == NULL)
+            {
+                continue;
+            }
+
+            MixChannel(ch, block);
+            active = true;
+
+            if (ch->pos >= ch->length)
+            {
+                ch->data = NULL;
+                SDL_AtomicSet(&mixchannel_done[c], ch->voice);
+            }
+        }
+
+        if (active)
+        {
+            for (i = 0; i < block * 2; ++i)
+            {
+                float sample = out[i] + mix_buffer[i];
+
+                // Branchless, so that this loop vectorizes too.
+                sample = sample > INT16_MAX ? INT16_MAX : sample;
+                sample = sample < INT16_MIN ? INT16_MIN : sample;
+
+                out[i] = (Sint16) sample;
+            }
+        }
+
+        out += block * 2;
+        frames -= block;
     }
 }
 
@@ -407,23 +767,21 @@ static int SRC_ConversionMode(void)
 //   unsigned 8 bits --> signed 16 bits
 //   mono --> stereo
 //   samplerate --> mixer_freq
-// Returns number of clipped samples.
+// Returns a newly allocated buffer holding the expanded sound.
 // DWF 2008-02-10 with cleanups by Simon Howard.
 
-static boolean ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
-                                   byte *data,
-                                   int samplerate,
-                                   int bits,
-                                   int length)
+static byte *ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
+                                 byte *data,
+                                 int samplerate,
+                                 int bits,
+                                 int length,
+                                 uint32_t *expanded_length)
 {
     SRC_DATA src_data;
     float *data_in;
     uint32_t i, abuf_index=0, clipped=0;
-//    uint32_t alen;
     int retn;
     int16_t *expanded;
-    allocated_sound_t *snd;
-    Mix_Chunk *chunk;
     uint32_t samplecount = length / (bits / 8);
 
     src_data.input_frames = samplecount;
@@ -463,20 +821,18 @@ static boolean ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
     retn = src_simple(&src_data, SRC_ConversionMode(), 1);
     assert(retn == 0);
 
-    // Allocate the new chunk.
+    // Allocate the output buffer.
 
-//    alen = src_data.output_frames_gen * 4;
+    *expanded_length = src_data.output_frames_gen * 4;
+    expanded = malloc(*expanded_length);
 
-    snd = AllocateSound(sfxinfo, src_data.output_frames_gen * 4);
-
-    if (snd == NULL)
+    if (expanded == NULL)
     {
-        return false;
+        free(data_in);
+        free(src_data.data_out);
+        return NULL;
     }
 
-    chunk = &snd->chunk;
-    expanded = (int16_t *) chunk->abuf;
-
     // Convert the result back into 16-bit integers.
 
     for (i=0; i<src_data.output_frames_gen; ++i)
@@ -531,10 +887,10 @@ static boolean ExpandSoundData_SRC(sfxinfo_t *sfxinfo,
     {
         fprintf(stderr, "Sound '%s': clipped %u samples (%0.2f %%)\n", 
                         sfxinfo->name, clipped,
-                        400.0 * clipped / chunk->alen);
+                        400.0 * clipped / *expanded_length);
     }
 
-    return true;
+    return (byte *) expanded;
 }
 
 #endif
@@ -619,38 +975,38 @@ static void WriteWAV(char *filename, byte *data,
 #endif
 
 // Generic sound expansion function for any sample rate.
-// Returns number of clipped samples (always 0).
-
-static boolean ExpandSoundData_SDL(sfxinfo_t *sfxinfo,
-                                   byte *data,
-                                   int samplerate,
-                                   int bits,
-                                   int length)
+// Returns a newly allocated buffer holding the expanded sound.
+
+static byte *ExpandSoundData_SDL(sfxinfo_t *sfxinfo,
+                                 byte *data,
+                                 int samplerate,
+                                 int bits,
+                                 int length,
+                                 uint32_t *expanded_length)
 {
     SDL_AudioCVT convertor;
-    allocated_sound_t *snd;
-    Mix_Chunk *chunk;
-    uint32_t expanded_length;
+    byte *abuf;
+    uint32_t alen;
     uint32_t samplecount = length / (bits / 8);
 
     // Calculate the length of the expanded version of the sample.
 
-    expanded_length = (uint32_t) ((((uint64_t) samplecount) * mixer_freq) / samplerate);
+    alen = (uint32_t) ((((uint64_t) samplecount) * mixer_freq) / samplerate);
 
     // Double up twice: 8 -> 16 bit and mono -> stereo
 
-    expanded_length *= 4;
+    alen *= 4;
 
-    // Allocate a chunk in which to expand the sound
+    // Allocate a buffer in which to expand the sound
 
-    snd = AllocateSound(sfxinfo, expanded_length);
+    abuf = malloc(alen);
 
-    if (snd == NULL)
+    if (abuf == NULL)
     {
-        return false;
+        return NULL;
     }
 
-    chunk = &snd->chunk;
+    *expanded_length = alen;
 
     // If we can, use the standard / optimized SDL conversion routines.
 
@@ -667,12 +1023,12 @@ static boolean ExpandSoundData_SDL(sfxinfo_t *sfxinfo,
 
         SDL_ConvertAudio(&convertor);
 
-        memcpy(chunk->abuf, convertor.buf, chunk->alen);
+        memcpy(abuf, convertor.buf, alen);
         free(convertor.buf);
     }
     else
     {
-        Sint16 *expanded = (Sint16 *) chunk->abuf;
+        Sint16 *expanded = (Sint16 *) abuf;
         int expanded_length;
         int expand_ratio;
         int i;
@@ -742,27 +1098,30 @@ static boolean ExpandSoundData_SDL(sfxinfo_t *sfxinfo,
 #endif /* #ifdef LOW_PASS_FILTER */
     }
 
-    return true;
+    return abuf;
 }
 
-// Load and convert a sound effect
-// Returns true if successful
+// [AP] A sound effect being loaded and converted. The lump is cached by
+// the main thread; everything else can be done on a worker thread.
 
-static boolean CacheSFX(sfxinfo_t *sfxinfo)
+typedef struct
 {
+    sfxinfo_t *sfxinfo;
     int lumpnum;
+    byte *lumpdata;
     unsigned int lumplen;
-    int samplerate;
-    unsigned int bits;
-    unsigned int length;
-    byte *data;
 
-    // need to load the sound
+    byte *expanded;
+    uint32_t expanded_length;
+} sfxjob_t;
 
-    lumpnum = sfxinfo->lumpnum;
-    data = W_CacheLumpNum(lumpnum, PU_STATIC);
-    lumplen = W_LumpLength(lumpnum);
+// Parse a sound lump header. On success, returns a pointer to the sample
+// data and fills in its format.
 
+static byte *ParseSFXLump(byte *data, unsigned int lumplen,
+                          int *samplerate, unsigned int *bits,
+                          unsigned int *length)
+{
     // [crispy] Check if this is a valid RIFF wav file
     if (lumplen > 44 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVEfmt ", 8) == 0)
     {
@@ -773,32 +1132,32 @@ static boolean CacheSFX(sfxinfo_t *sfxinfo)
         // "fmt " chunk size must == 16
         check = data[16] | (data[17] << 8) | (data[18] << 16) | (data[19] << 24);
         if (check != 16)
-            return false;
+            return NULL;
 
         // Format must == 1 (PCM)
         check = data[20] | (data[21] << 8);
         if (check != 1)
-            return false;
+            return NULL;
 
         // FIXME: can't handle stereo wavs
         // Number of channels must == 1
         check = data[22] | (data[23] << 8);
         if (check != 1)
-            return false;
+            return NULL;
 
-        samplerate = data[24] | (data[25] << 8) | (data[26] << 16) | (data[27] << 24);
-        length = data[40] | (data[41] << 8) | (data[42] << 16) | (data[43] << 24);
+        *samplerate = data[24] | (data[25] << 8) | (data[26] << 16) | (data[27] << 24);
+        *length = data[40] | (data[41] << 8) | (data[42] << 16) | (data[43] << 24);
 
-        if (length > lumplen - 44)
-            length = lumplen - 44;
+        if (*length > lumplen - 44)
+            *length = lumplen - 44;
 
-        bits = data[34] | (data[35] << 8);
+        *bits = data[34] | (data[35] << 8);
 
         // Reject non 8 or 16 bit
-        if (bits != 16 && bits != 8)
-            return false;
+        if (*bits != 16 && *bits != 8)
+            return NULL;
 
-        data += 44 - 8;
+        return data + 44;
     }
     // Check the header, and ensure this is a valid sound
     else if (lumplen >= 8 && data[0] == 0x03 && data[1] == 00)
@@ -806,8 +1165,8 @@ static boolean CacheSFX(sfxinfo_t *sfxinfo)
         // Valid DOOM sound
 
         // 16 bit sample rate field, 32 bit length field
-        samplerate = (data[3] << 8) | data[2];
-        length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+        *samplerate = (data[3] << 8) | data[2];
+        *length = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
 
         // If the header specifies that the length of the sound is greater than
         // the length of the lump itself, this is an invalid sound lump
@@ -818,29 +1177,199 @@ static boolean CacheSFX(sfxinfo_t *sfxinfo)
         // further investigation to better understand the correct
         // behavior.
 
-        if (length > lumplen - 8 || length <= 48)
+        if (*length > lumplen - 8 || *length <= 48)
         {
-            return false;
+            return NULL;
         }
 
         // All Doom sounds are 8-bit
-        bits = 8;
+        *bits = 8;
 
         // The DMX sound library seems to skip the first 16 and last 16
         // bytes of the lump - reason unknown.
 
-        data += 16;
-        length -= 32;
+        *length -= 32;
+
+        return data + 8 + 16;
     }
     else
     {
         // Invalid sound
+        return NULL;
+    }
+}
+
+// [AP] Resample cache file name for a lump. The key covers everything
+// that affects the converted output: the lump contents, the output
+// format and the conversion method.
+
+static char *SFXCacheFileName(byte *lumpdata, unsigned int lumplen)
+{
+    sha1_context_t context;
+    sha1_digest_t hash;
+    char hashstr[sizeof(sha1_digest_t) * 2 + 1];
+    char key[64];
+    int i;
+
+    SHA1_Init(&context);
+    SHA1_Update(&context, lumpdata, lumplen);
+    SHA1_Final(hash, &context);
+
+    for (i = 0; i < sizeof(sha1_digest_t); ++i)
+    {
+        M_snprintf(hashstr + i * 2, sizeof(hashstr) - i * 2,
+                   "%02x", hash[i]);
+    }
+
+    M_snprintf(key, sizeof(key), "-%d-%04x-%d-%d-%d.pcm",
+               mixer_freq, mixer_format, mixer_channels,
+               use_libsamplerate, (int) (libsamplerate_scale * 1000));
+
+    return M_StringJoin(sfx_cache_dir, hashstr, key, NULL);
+}
+
+static boolean ReadSFXCache(const char *filename, sfxjob_t *job)
+{
+    FILE *fstream;
+    long len;
+
+    fstream = M_fopen(filename, "rb");
+
+    if (fstream == NULL)
+    {
+        return false;
+    }
+
+    len = M_FileLength(fstream);
+
+    if (len <= 0 || (len % 4) != 0
+     || (job->expanded = malloc(len)) == NULL)
+    {
+        fclose(fstream);
         return false;
     }
 
+    if (fread(job->expanded, 1, len, fstream) != len)
+    {
+        free(job->expanded);
+        job->expanded = NULL;
+        fclose(fstream);
+        return false;
+    }
+
+    fclose(fstream);
+
+    job->expanded_length = len;
+
+    return true;
+}
+
+// Written under a temporary name and renamed into place, so that a
+// partial file is never picked up and two sound effects sharing a lump
+// can safely race each other.
+
+static void WriteSFXCache(const char *filename, sfxjob_t *job)
+{
+    char tempname[16];
+    char *temppath;
+    FILE *fstream;
+    boolean ok;
+
+    M_snprintf(tempname, sizeof(tempname), ".%d.tmp", job->lumpnum);
+    temppath = M_StringJoin(filename, tempname, NULL);
+
+    fstream = M_fopen(temppath, "wb");
+
+    if (fstream != NULL)
+    {
+        ok = fwrite(job->expanded, 1, job->expanded_length, fstream)
+                == job->expanded_length;
+        ok = (fclose(fstream) == 0) && ok;
+
+        if (!ok || M_rename(temppath, filename) != 0)
+        {
+            M_remove(temppath);
+        }
+    }
+
+    free(temppath);
+}
+
+// Convert a sound effect lump into the mixer's output format.
+// Safe to call from a worker thread.
+
+static void ExpandSFXJob(sfxjob_t *job)
+{
+    byte *data;
+    int samplerate;
+    unsigned int bits;
+    unsigned int length;
+    char *cachefile = NULL;
+
+    job->expanded = NULL;
+
+    data = ParseSFXLump(job->lumpdata, job->lumplen,
+                        &samplerate, &bits, &length);
+
+    if (data == NULL)
+    {
+        return;
+    }
+
+    if (sfx_cache_dir != NULL)
+    {
+        cachefile = SFXCacheFileName(job->lumpdata, job->lumplen);
+
+        if (ReadSFXCache(cachefile, job))
+        {
+            free(cachefile);
+            return;
+        }
+    }
+
     // Sample rate conversion
 
-    if (!ExpandSoundData(sfxinfo, data + 8, samplerate, bits, length))
+    job->expanded = ExpandSoundData(job->sfxinfo, data, samplerate, bits,
+                                    length, &job->expanded_length);
+
+    if (job->expanded != NULL && cachefile != NULL)
+    {
+        WriteSFXCache(cachefile, job);
+    }
+
+    free(cachefile);
+}
+
+static void ExpandSFXJobWorker(void *data, int index)
+{
+    ExpandSFXJob((sfxjob_t *) data + index);
+}
+
+// Hand the converted data of a finished job over to the allocated sound
+// list, and release the lump. Main thread only.
+
+static boolean FinishSFXJob(sfxjob_t *job)
+{
+    allocated_sound_t *snd;
+
+    W_ReleaseLumpNum(job->lumpnum);
+
+    if (job->expanded == NULL)
+    {
+        return false;
+    }
+
+    snd = AllocateSound(job->sfxinfo, job->expanded_length);
+
+    if (snd != NULL)
+    {
+        memcpy(snd->chunk.abuf, job->expanded, job->expanded_length);
+    }
+
+    free(job->expanded);
+    job->expanded = NULL;
+
+    if (snd == NULL)
     {
         return false;
     }
@@ -848,22 +1377,40 @@ static boolean CacheSFX(sfxinfo_t *sfxinfo)
 #ifdef DEBUG_DUMP_WAVS
     {
         char filename[16];
-        allocated_sound_t * snd;
 
         M_snprintf(filename, sizeof(filename), "%s.wav",
-                   DEH_String(sfxinfo->name));
-        snd = GetAllocatedSoundBySfxInfoAndPitch(sfxinfo, NORM_PITCH);
-        WriteWAV(filename, snd->chunk.abuf, snd->chunk.alen,mixer_freq);
+                   DEH_String(job->sfxinfo->name));
+        WriteWAV(filename, snd->chunk.abuf, snd->chunk.alen, mixer_freq);
     }
 #endif
 
-    // don't need the original lump any more
-  
-    W_ReleaseLumpNum(lumpnum);
-
     return true;
 }
 
+static void StartSFXJob(sfxjob_t *job, sfxinfo_t *sfxinfo)
+{
+    job->sfxinfo = sfxinfo;
+    job->lumpnum = sfxinfo->lumpnum;
+    job->lumpdata = W_CacheLumpNum(job->lumpnum, PU_STATIC);
+    job->lumplen = W_LumpLength(job->lumpnum);
+    job->expanded = NULL;
+}
+
+// Load and convert a sound effect
+// Returns true if successful
+
+static boolean CacheSFX(sfxinfo_t *sfxinfo)
+{
+    sfxjob_t job;
+
+    // need to load the sound
+
+    StartSFXJob(&job, sfxinfo);
+    ExpandSFXJob(&job);
+
+    return FinishSFXJob(&job);
+}
+
 static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
 {
     // Linked sfx lumps? Get the lump number for the sound linked to.
@@ -888,31 +1435,47 @@ static void GetSfxLumpName(sfxinfo_t *sfx, char *buf, size_t buf_len)
 
 // Preload all the sound effects - stops nasty ingame freezes
 
+// [AP] Lumps are cached here on the main thread, then the conversions
+// (or resample cache lookups) are spread across worker threads.
+
 static void I_SDL_PrecacheSounds(sfxinfo_t *sounds, int num_sounds)
 {
     char namebuf[9];
+    sfxjob_t *jobs;
+    int num_jobs = 0;
     int i;
 
     printf("I_SDL_PrecacheSounds: Precaching all sound effects..");
 
+    jobs = malloc(num_sounds * sizeof(*jobs));
+
     for (i=0; i<num_sounds; ++i)
     {
-        if ((i % 6) == 0)
-        {
-            printf(".");
-            fflush(stdout);
-        }
-
         GetSfxLumpName(&sounds[i], namebuf, sizeof(namebuf));
 
         sounds[i].lumpnum = W_CheckNumForName(namebuf);
 
         if (sounds[i].lumpnum != -1)
         {
-            CacheSFX(&sounds[i]);
+            StartSFXJob(&jobs[num_jobs++], &sounds[i]);
         }
     }
 
+    I_ParallelFor(ExpandSFXJobWorker, jobs, num_jobs);
+
+    for (i=0; i<num_jobs; ++i)
+    {
+        if ((i % 6) == 0)
+        {
+            printf(".");
+            fflush(stdout);
+        }
+
+        FinishSFXJob(&jobs[i]);
+    }
+
+    free(jobs);
+
     printf("\n");
 }
 
@@ -949,22 +1512,46 @@ static int I_SDL_GetSfxLumpNum(sfxinfo_t *sfx)
     return W_CheckNumForName(namebuf);
 }
 
+static void CalculatePanning(int vol, int sep, int *left, int *right)
+{
+    *left = ((254 - sep) * vol) / 127;
+    *right = ((sep) * vol) / 127;
+
+    if (*left < 0) *left = 0;
+    else if (*left > 255) *left = 255;
+    if (*right < 0) *right = 0;
+    else if (*right > 255) *right = 255;
+}
+
 static void I_SDL_UpdateSoundParams(int handle, int vol, int sep)
 {
     int left, right;
 
-    if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
+    if (!sound_initialized || handle < 0 || handle >= snd_maxchannels)
     {
         return;
     }
 
-    left = ((254 - sep) * vol) / 127;
-    right = ((sep) * vol) / 127;
+    CalculatePanning(vol, sep, &left, &right);
 
-    if (left < 0) left = 0;
-    else if ( left > 255) left = 255;
-    if (right < 0) right = 0;
-    else if (right > 255) right = 255;
+    if (use_internal_mixer)
+    {
+        mixcmd_t cmd;
+
+        if (channels_playing[handle] == NULL)
+        {
+            return;
+        }
+
+        cmd.type = MIXCMD_PARAMS;
+        cmd.channel = handle;
+        cmd.voice = channel_voice[handle];
+        cmd.snd = NULL;
+        cmd.left = left / 255.0f;
+        cmd.right = right / 255.0f;
+        PushMixCommand(&cmd);
+        return;
+    }
 
     Mix_SetPanning(handle, left, right);
 }
@@ -986,7 +1573,7 @@ static int I_SDL_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, i
 {
     allocated_sound_t *snd;
 
-    if (!sound_initialized || channel < 0 || channel >= NUM_CHANNELS)
+    if (!sound_initialized || channel < 0 || channel >= snd_maxchannels)
     {
         return -1;
     }
@@ -1035,6 +1622,33 @@ static int I_SDL_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, i
 
     // play sound
 
+    if (use_internal_mixer)
+    {
+        mixcmd_t cmd;
+        int left, right;
+
+        CalculatePanning(vol, sep, &left, &right);
+
+        channel_voice[channel] = next_voice++;
+
+        cmd.type = MIXCMD_START;
+        cmd.channel = channel;
+        cmd.voice = channel_voice[channel];
+        cmd.snd = snd;
+        cmd.left = left / 255.0f;
+        cmd.right = right / 255.0f;
+
+        if (!PushMixCommand(&cmd))
+        {
+            UnlockReleasedSound(snd);
+            return -1;
+        }
+
+        channels_playing[channel] = snd;
+
+        return channel;
+    }
+
     Mix_PlayChannel(channel, &snd->chunk, 0);
 
     channels_playing[channel] = snd;
@@ -1048,7 +1662,7 @@ static int I_SDL_StartSound(sfxinfo_t *sfxinfo, int channel, int vol, int sep, i
 
 static void I_SDL_StopSound(int handle)
 {
-    if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
+    if (!sound_initialized || handle < 0 || handle >= snd_maxchannels)
     {
         return;
     }
@@ -1062,11 +1676,17 @@ static void I_SDL_StopSound(int handle)
 
 static boolean I_SDL_SoundIsPlaying(int handle)
 {
-    if (!sound_initialized || handle < 0 || handle >= NUM_CHANNELS)
+    if (!sound_initialized || handle < 0 || handle >= snd_maxchannels)
     {
         return false;
     }
 
+    if (use_internal_mixer)
+    {
+        return channels_playing[handle] != NULL
+            && SDL_AtomicGet(&mixchannel_done[handle]) != channel_voice[handle];
+    }
+
     return Mix_Playing(handle);
 }
 
@@ -1080,7 +1700,7 @@ static void I_SDL_UpdateSound(void)
 
     // Check all channels to see if a sound has finished
 
-    for (i=0; i<NUM_CHANNELS; ++i)
+    for (i=0; i<snd_maxchannels; ++i)
     {
         if (channels_playing[i] && !I_SDL_SoundIsPlaying(i))
         {
@@ -1090,6 +1710,11 @@ static void I_SDL_UpdateSound(void)
             ReleaseSoundOnChannel(i);
         }
     }
+
+    if (use_internal_mixer)
+    {
+        ReapRetiredSounds();
+    }
 }
 
 static void I_SDL_ShutdownSound(void)
@@ -1099,6 +1724,12 @@ static void I_SDL_ShutdownSound(void)
         return;
     }
 
+    if (use_internal_mixer)
+    {
+        Mix_SetPostMix(NULL, NULL);
+        use_internal_mixer = false;
+    }
+
     Mix_CloseAudio();
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
 
@@ -1139,7 +1770,7 @@ static boolean I_SDL_InitSound(GameMission_t mission)
     use_sfx_prefix = (mission == doom || mission == strife);
 
     // No sounds yet
-    for (i=0; i<NUM_CHANNELS; ++i)
+    for (i=0; i<NUM_MIX_CHANNELS; ++i)
     {
         channels_playing[i] = NULL;
     }
@@ -1180,7 +1811,49 @@ static boolean I_SDL_InitSound(GameMission_t mission)
     }
 #endif
 
+    // [AP] Converted sound effects are cached on disk, so that they only
+    // have to be resampled the first time they are used.
+
+    if (snd_resamplecache && sfx_cache_dir == NULL)
+    {
+        sfx_cache_dir = M_GetCacheDir("sfx");
+    }
+
     Mix_AllocateChannels(NUM_CHANNELS);
+    snd_maxchannels = NUM_CHANNELS;
+
+    // [AP] The internal mixer works on the sound data in place, so it
+    // can only be used if the device gave us signed 16-bit stereo.
+
+    if (snd_internalmixer)
+    {
+        if (mixer_format == AUDIO_S16SYS && mixer_channels == 2)
+        {
+            memset(mixchannels, 0, sizeof(mixchannels));
+
+            for (i=0; i<NUM_MIX_CHANNELS; ++i)
+            {
+                SDL_AtomicSet(&mixchannel_done[i], 0);
+                channel_voice[i] = 0;
+            }
+
+            SDL_AtomicSet(&mixcmd_head, 0);
+            SDL_AtomicSet(&mixcmd_tail, 0);
+            num_retired_sounds = 0;
+
+            // [AP] Not limited by SDL_mixer's channels, so a lot more
+            // sounds can play at once.
+            snd_maxchannels = NUM_MIX_CHANNELS;
+
+            use_internal_mixer = true;
+            Mix_SetPostMix(I_SDL_MixSfx, NULL);
+        }
+        else
+        {
+            fprintf(stderr, "I_SDL_InitSound: snd_internalmixer requires "
+                            "16-bit stereo output, using SDL_mixer channels.\n");
+        }
+    }
 
     SDL_PauseAudio(0);
 
@@ -218,7 +218,8 @@ void I_InitSound(GameMission_t mission)
     // Disable all sound output.
     //
 
-    nosound = M_CheckParm("-nosound") > 0;
+    nosound = M_CheckParm("-nosound") > 0
+           || M_ParmExists("-headless"); // [AP]
 
     //!
     // @vanilla
@@ -588,5 +589,7 @@ void I_BindSoundVariables(void)
 
     M_BindIntVariable("use_libsamplerate",       &use_libsamplerate);
     M_BindFloatVariable("libsamplerate_scale",   &libsamplerate_scale);
+    M_BindIntVariable("snd_internalmixer",       &snd_internalmixer);
+    M_BindIntVariable("snd_resamplecache",       &snd_resamplecache);
 }
 
@@ -242,6 +242,9 @@ extern int snd_pitchshift;
 extern char *snd_dmxoption;
 extern int use_libsamplerate;
 extern float libsamplerate_scale;
+extern int snd_internalmixer;
+extern int snd_resamplecache;
+extern int snd_maxchannels;
 
 void I_BindSoundVariables(void);
 
@@ -139,7 +139,7 @@ byte *I_ZoneBase (int *size)
     // @category obscure
     // @arg <mb>
     //
-    // Specify the heap size, in MiB.
+    // Specify the heap size, in MiB. The zone does not grow past it.
     //
 
     p = M_CheckParmWithArgs("-mb", 1);
@@ -303,6 +303,17 @@ void I_Quit (void)
 
 static boolean already_quitting = false;
 
+// [AP] Thread whose errors are handed off, see I_SetErrorHandoff().
+
+static SDL_threadID error_handoff_thread;
+static void (*error_handoff)(const char *msg);
+
+void I_SetErrorHandoff(void (*func)(const char *msg))
+{
+    error_handoff_thread = SDL_ThreadID();
+    error_handoff = func;
+}
+
 void I_Error (const char *error, ...)
 {
     char msgbuf[512];
@@ -310,6 +321,16 @@ void I_Error (const char *error, ...)
     atexit_listentry_t *entry;
     boolean exit_gui_popup;
 
+    // [AP] Exit functions and message boxes must run on the main thread.
+    if (error_handoff != NULL && SDL_ThreadID() == error_handoff_thread)
+    {
+        va_start(argptr, error);
+        M_vsnprintf(msgbuf, sizeof(msgbuf), error, argptr);
+        va_end(argptr);
+
+        error_handoff(msgbuf);
+    }
+
     if (already_quitting)
     {
         fprintf(stderr, "Warning: recursive call to I_Error detected.\n");
@@ -54,6 +54,11 @@ void I_Quit (void) NORETURN;
 
 void I_Error (const char *error, ...) NORETURN PRINTF_ATTR(1, 2);
 
+// [AP] Pass I_Error() messages raised on the calling thread to func
+// instead of exiting from it; func must not return.
+
+void I_SetErrorHandoff(void (*func)(const char *msg));
+
 void I_Tactile (int on, int off, int total);
 
 void *I_Realloc(void *ptr, size_t size);
@@ -0,0 +1,553 @@
+//
+// Copyright(C) 2026 Archipelago Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Worker threads for parallelizable, self-contained jobs.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "SDL.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
+#include "m_misc.h"
+
+typedef struct
+{
+    parallel_func_t func;
+    void *data;
+    int count;
+    SDL_atomic_t next;
+} parallel_job_t;
+
+static int num_worker_threads = 0;
+
+int I_NumWorkerThreads(void)
+{
+    if (num_worker_threads == 0)
+    {
+        //!
+        // Disable worker threads; all parallelizable work (sound effect
+        // conversion, level data generation and so on) is done on the
+        // main thread.
+        //
+
+        if (M_ParmExists("-nothreads"))
+        {
+            num_worker_threads = 1;
+        }
+        else
+        {
+            num_worker_threads = SDL_GetCPUCount();
+
+            if (num_worker_threads < 1)
+            {
+                num_worker_threads = 1;
+            }
+            else if (num_worker_threads > MAX_WORKER_THREADS)
+            {
+                num_worker_threads = MAX_WORKER_THREADS;
+            }
+        }
+    }
+
+    return num_worker_threads;
+}
+
+// Each thread keeps taking the next unclaimed index until there are none
+// left, so uneven jobs balance themselves out.
+
+static int ParallelWorker(void *arg)
+{
+    parallel_job_t *job = arg;
+    int i;
+
+    for (;;)
+    {
+        i = SDL_AtomicAdd(&job->next, 1);
+
+        if (i >= job->count)
+        {
+            break;
+        }
+
+        job->func(job->data, i);
+    }
+
+    return 0;
+}
+
+void I_ParallelFor(parallel_func_t func, void *data, int count)
+{
+    SDL_Thread *threads[MAX_WORKER_THREADS];
+    parallel_job_t job;
+    int num_threads;
+    int i;
+
+    job.func = func;
+    job.data = data;
+    job.count = count;
+    SDL_AtomicSet(&job.next, 0);
+
+    num_threads = I_NumWorkerThreads();
+
+    if (num_threads > count)
+    {
+        num_threads = count;
+    }
+
+    // The calling thread is a worker too, so only start num_threads - 1.
+    // If a thread can't be created we just end up with fewer workers.
+
+    for (i = 0; i < num_threads - 1; ++i)
+    {
+        threads[i] = SDL_CreateThread(ParallelWorker, "worker", &job);
+    }
+
+    ParallelWorker(&job);
+
+    for (i = 0; i < num_threads - 1; ++i)
+    {
+        if (threads[i] != NULL)
+        {
+            SDL_WaitThread(threads[i], NULL);
+        }
+    }
+}
+
+//
+// Background jobs.
+//
+
+struct background_job_s
+{
+    background_func_t func;
+    void *data;
+    SDL_Thread *thread;
+    SDL_atomic_t done;
+    SDL_atomic_t cancelled;
+};
+
+static int BackgroundJobThread(void *arg)
+{
+    background_job_t *job = arg;
+
+    job->func(job, job->data);
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&job->done, 1);
+
+    return 0;
+}
+
+background_job_t *I_StartBackgroundJob(background_func_t func, void *data)
+{
+    background_job_t *job;
+
+    job = malloc(sizeof(background_job_t));
+    job->func = func;
+    job->data = data;
+    job->thread = NULL;
+    SDL_AtomicSet(&job->done, 0);
+    SDL_AtomicSet(&job->cancelled, 0);
+
+    if (I_NumWorkerThreads() > 1)
+    {
+        job->thread = SDL_CreateThread(BackgroundJobThread, "background",
+                                       job);
+    }
+
+    if (job->thread == NULL)
+    {
+        BackgroundJobThread(job);
+    }
+
+    return job;
+}
+
+boolean I_BackgroundJobDone(background_job_t *job)
+{
+    if (SDL_AtomicGet(&job->done))
+    {
+        SDL_MemoryBarrierAcquire();
+        return true;
+    }
+
+    return false;
+}
+
+void I_CancelBackgroundJob(background_job_t *job)
+{
+    SDL_AtomicSet(&job->cancelled, 1);
+}
+
+boolean I_BackgroundJobCancelled(background_job_t *job)
+{
+    return SDL_AtomicGet(&job->cancelled) != 0;
+}
+
+void I_FinishBackgroundJob(background_job_t *job)
+{
+    if (job->thread != NULL)
+    {
+        SDL_WaitThread(job->thread, NULL);
+    }
+
+    SDL_MemoryBarrierAcquire();
+    free(job);
+}
+
+//
+// Background file writer.
+//
+
+typedef struct filewrite_s
+{
+    char *filename;
+    void *data;
+    int length;
+    filewrite_filter_t filter;
+    struct filewrite_s *next;
+} filewrite_t;
+
+static SDL_Thread *writer_thread = NULL;
+static SDL_mutex *writer_mutex;
+static SDL_cond *writer_queued;     // signalled when a job is added
+static SDL_cond *writer_finished;   // signalled when a job completes
+
+static filewrite_t *writer_head, *writer_tail;
+static filewrite_t *writer_current;
+
+// Name of the first file that could not be written, and of the copy
+// saved for recovery, if any; reported (fatally) from the main thread,
+// as the writer thread can't call I_Error.
+static char *writer_failed = NULL;
+static char *writer_recovery = NULL;
+
+static boolean WriteFileDurably(const char *filename, const void *data,
+                                int length)
+{
+    char *tempname;
+    FILE *stream;
+    boolean result;
+
+    tempname = M_StringJoin(filename, ".tmp", NULL);
+    stream = M_fopen(tempname, "wb");
+    result = false;
+
+    if (stream != NULL)
+    {
+        result = fwrite(data, 1, length, stream) == length
+              && fflush(stream) == 0;
+#ifdef _WIN32
+        result = result && _commit(_fileno(stream)) == 0;
+#else
+        result = result && fsync(fileno(stream)) == 0;
+#endif
+        result = fclose(stream) == 0 && result;
+    }
+
+    if (result)
+    {
+        M_remove(filename);
+        result = M_rename(tempname, filename) == 0;
+    }
+    else
+    {
+        M_remove(tempname);
+    }
+
+    free(tempname);
+
+    return result;
+}
+
+// If a file can't be written, save it to the temp directory instead
+// before giving up, so that nothing is lost. Returns the name of the
+// copy, or NULL if that failed as well.
+
+static char *WriteRecoveryFile(const char *filename, const void *data,
+                               int length)
+{
+    char *recoveryname;
+    char *recovery;
+
+    recoveryname = M_StringJoin("recovery-", M_BaseName(filename), NULL);
+    recovery = M_TempFile(recoveryname);
+    free(recoveryname);
+
+    if (!WriteFileDurably(recovery, data, length))
+    {
+        free(recovery);
+        return NULL;
+    }
+
+    fprintf(stderr, "Saved '%s' to '%s' for recovery\n",
+            filename, recovery);
+
+    return recovery;
+}
+
+static void FileWriteError(const char *filename, const char *recovery)
+{
+    if (recovery != NULL)
+    {
+        I_Error("Failed to write file '%s'.\n"
+                "But it has been saved to '%s' for recovery.",
+                filename, recovery);
+    }
+
+    I_Error("Failed to write file '%s'.", filename);
+}
+
+static int FileWriterThread(void *unused)
+{
+    filewrite_t *job;
+    char *recovery;
+    boolean result;
+
+    SDL_LockMutex(writer_mutex);
+
+    for (;;)
+    {
+        while (writer_head == NULL)
+        {
+            SDL_CondWait(writer_queued, writer_mutex);
+        }
+
+        job = writer_head;
+        writer_head = job->next;
+        if (writer_head == NULL)
+        {
+            writer_tail = NULL;
+        }
+        writer_current = job;
+
+        SDL_UnlockMutex(writer_mutex);
+        if (job->filter != NULL)
+        {
+            job->data = job->filter(job->data, &job->length);
+        }
+        result = WriteFileDurably(job->filename, job->data, job->length);
+        recovery = NULL;
+
+        if (!result)
+        {
+            fprintf(stderr, "FileWriterThread: Failed to write '%s'\n",
+                    job->filename);
+            recovery = WriteRecoveryFile(job->filename, job->data,
+                                         job->length);
+        }
+
+        SDL_LockMutex(writer_mutex);
+
+        if (!result && writer_failed == NULL)
+        {
+            writer_failed = job->filename;
+            writer_recovery = recovery;
+            job->filename = NULL;
+            recovery = NULL;
+        }
+
+        free(recovery);
+
+        writer_current = NULL;
+        SDL_CondBroadcast(writer_finished);
+
+        free(job->filename);
+        free(job->data);
+        free(job);
+    }
+
+    return 0;
+}
+
+static void CheckFileWriteError(void)
+{
+    char *failed, *recovery;
+
+    if (writer_thread == NULL)
+    {
+        return;
+    }
+
+    SDL_LockMutex(writer_mutex);
+    failed = writer_failed;
+    recovery = writer_recovery;
+    SDL_UnlockMutex(writer_mutex);
+
+    // Not under the lock: I_Error waits for the remaining writes.
+    if (failed != NULL)
+    {
+        FileWriteError(failed, recovery);
+    }
+}
+
+static boolean FileWritePending(const char *filename)
+{
+    filewrite_t *job;
+
+    if (writer_current != NULL
+     && (filename == NULL || !strcmp(writer_current->filename, filename)))
+    {
+        return true;
+    }
+
+    for (job = writer_head; job != NULL; job = job->next)
+    {
+        if (filename == NULL || !strcmp(job->filename, filename))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void WaitForFileWrites(const char *filename)
+{
+    if (writer_thread == NULL)
+    {
+        return;
+    }
+
+    SDL_LockMutex(writer_mutex);
+
+    while (FileWritePending(filename))
+    {
+        SDL_CondWait(writer_finished, writer_mutex);
+    }
+
+    SDL_UnlockMutex(writer_mutex);
+}
+
+static void WaitAllFileWrites(void)
+{
+    WaitForFileWrites(NULL);
+}
+
+static boolean StartFileWriter(void)
+{
+    if (writer_thread != NULL)
+    {
+        return true;
+    }
+
+    if (I_NumWorkerThreads() < 2)
+    {
+        return false;
+    }
+
+    writer_mutex = SDL_CreateMutex();
+    writer_queued = SDL_CreateCond();
+    writer_finished = SDL_CreateCond();
+    writer_thread = SDL_CreateThread(FileWriterThread, "filewriter", NULL);
+
+    if (writer_thread == NULL)
+    {
+        SDL_DestroyCond(writer_finished);
+        SDL_DestroyCond(writer_queued);
+        SDL_DestroyMutex(writer_mutex);
+        return false;
+    }
+
+    // Anything still queued must reach the disk before we exit, even
+    // if we are exiting because of an error.
+
+    I_AtExit(WaitAllFileWrites, true);
+
+    return true;
+}
+
+void I_WriteFileAsync(const char *filename, void *data, int length,
+                      filewrite_filter_t filter)
+{
+    filewrite_t *job;
+
+    if (!StartFileWriter())
+    {
+        // Single-threaded: write it now.
+
+        if (filter != NULL)
+        {
+            data = filter(data, &length);
+        }
+
+        if (!WriteFileDurably(filename, data, length))
+        {
+            char *recovery = WriteRecoveryFile(filename, data, length);
+
+            free(data);
+            FileWriteError(filename, recovery);
+        }
+
+        free(data);
+        return;
+    }
+
+    CheckFileWriteError();
+
+    SDL_LockMutex(writer_mutex);
+
+    // A write of this file that hasn't started yet is now stale, so just
+    // swap in the new contents.
+
+    for (job = writer_head; job != NULL; job = job->next)
+    {
+        if (!strcmp(job->filename, filename))
+        {
+            free(job->data);
+            job->data = data;
+            job->length = length;
+            job->filter = filter;
+            SDL_UnlockMutex(writer_mutex);
+            return;
+        }
+    }
+
+    job = malloc(sizeof(filewrite_t));
+    job->filename = M_StringDuplicate(filename);
+    job->data = data;
+    job->length = length;
+    job->filter = filter;
+    job->next = NULL;
+
+    if (writer_tail != NULL)
+    {
+        writer_tail->next = job;
+    }
+    else
+    {
+        writer_head = job;
+    }
+    writer_tail = job;
+
+    SDL_CondSignal(writer_queued);
+    SDL_UnlockMutex(writer_mutex);
+}
+
+void I_WaitFileWrites(const char *filename)
+{
+    WaitForFileWrites(filename);
+    CheckFileWriteError();
+}
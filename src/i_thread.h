@@ -0,0 +1,80 @@
+//
+// Copyright(C) 2026 Archipelago Doom contributors
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Worker threads for parallelizable, self-contained jobs.
+//
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+#include "doomtype.h"
+
+// Upper bound on the number of worker threads ever started at once.
+#define MAX_WORKER_THREADS 16
+
+typedef void (*parallel_func_t)(void *data, int index);
+
+// Optional transform applied to a buffer on the I/O thread before it is
+// written (compression, say). Returns a malloc()ed buffer and its new
+// length; data is either returned as-is or freed.
+typedef void *(*filewrite_filter_t)(void *data, int *length);
+
+// Number of threads I_ParallelFor will use, including the caller.
+// Returns 1 if threading has been disabled with -nothreads.
+int I_NumWorkerThreads(void);
+
+// Call func(data, i) for every i in [0, count), spread across worker
+// threads, and return once all calls have completed. The order in which
+// indices are processed is unspecified; func must not touch the zone
+// allocator, the WAD cache or any other non-thread-safe global state.
+void I_ParallelFor(parallel_func_t func, void *data, int count);
+
+// A job running on a thread of its own, alongside the game.
+typedef struct background_job_s background_job_t;
+
+typedef void (*background_func_t)(background_job_t *job, void *data);
+
+// Start func(job, data) on a new thread. If threading has been disabled
+// or the thread can't be created, func runs to completion before this
+// returns. The same restrictions as for I_ParallelFor apply to func,
+// which may itself call I_ParallelFor.
+background_job_t *I_StartBackgroundJob(background_func_t func, void *data);
+
+// True once func has returned.
+boolean I_BackgroundJobDone(background_job_t *job);
+
+// Ask func to stop early. A long-running func should poll
+// I_BackgroundJobCancelled and return when it becomes true.
+void I_CancelBackgroundJob(background_job_t *job);
+boolean I_BackgroundJobCancelled(background_job_t *job);
+
+// Wait for func to return, then free the job.
+void I_FinishBackgroundJob(background_job_t *job);
+
+// Write a file on the background I/O thread. The writer takes ownership
+// of data, which must have been allocated with malloc(). The file is
+// written under a temporary name, flushed to disk and then renamed into
+// place, so a half-written file is never seen. A newer write to the same
+// file replaces one that has not started yet. filter may be NULL.
+// If the file can't be written, a copy is saved to the temp directory
+// for recovery, and the next call to either function exits with an
+// error naming both.
+void I_WriteFileAsync(const char *filename, void *data, int length,
+                      filewrite_filter_t filter);
+
+// Block until any queued or in-progress write of filename has reached
+// the disk; if filename is NULL, wait for all of them.
+void I_WaitFileWrites(const char *filename);
+
+#endif
@@ -893,6 +893,15 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(show_diskicon),
 
+    //!
+    // @game doom
+    //
+    // If non-zero and the framerate is uncapped, game tics are run on a
+    // separate thread while the previous frame is being presented.
+    //
+
+    CONFIG_VARIABLE_INT(playsim_thread),
+
     //!
     // If non-zero, save screenshots in PNG format. If zero, screenshots are
     // saved in PCX format, as Vanilla Doom does.
@@ -999,6 +1008,23 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_FLOAT(libsamplerate_scale),
 
+    //!
+    // If non-zero, sound effects are mixed by an internal software mixer
+    // rather than by SDL_mixer. Sound starts, stops and volume changes
+    // are queued to the audio thread without taking the audio lock, and
+    // volume and separation changes are ramped to avoid clicks. Up to
+    // 128 sound channels (snd_channels) can then be used, instead of 32.
+    //
+
+    CONFIG_VARIABLE_INT(snd_internalmixer),
+
+    //!
+    // If non-zero, sound effects converted to the output sample rate
+    // are cached on disk, so that later runs can skip the conversion.
+    //
+
+    CONFIG_VARIABLE_INT(snd_resamplecache),
+
     //!
     // Full path to a directory in which WAD files and dehacked patches
     // can be placed to be automatically loaded on startup. A subdirectory
@@ -1177,6 +1203,49 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(vanilla_savegame_limit),
 
+    //!
+    // @game doom
+    //
+    // If non-zero, per-level savegames are written zlib-compressed (when
+    // built with zlib).  Both compressed and uncompressed savegames can
+    // always be loaded.
+    //
+
+    CONFIG_VARIABLE_INT(savegame_compression),
+
+    //!
+    // @game doom
+    //
+    // If non-zero, savegames only store the sectors, lines and sides that
+    // differ from the level as freshly loaded.  Savegames written in either
+    // mode can always be loaded.
+    //
+
+    CONFIG_VARIABLE_INT(savegame_delta),
+
+    //!
+    // @game doom
+    //
+    // If non-zero, traces such as hitscan attacks that cross more than
+    // 128 lines and things overwrite the same variables that they
+    // overwrite in Vanilla Doom.  This is always done in demos and
+    // multiplayer games.
+    //
+
+    CONFIG_VARIABLE_INT(emulate_intercepts_overrun),
+
+    //!
+    // @game doom
+    //
+    // If non-zero, monsters that are waiting for a player further away
+    // than this many map units from every player, and that the REJECT
+    // table says cannot see any player, only think every fourth tic.
+    // They go back to thinking every tic as soon as they are woken.
+    // Never used in demos or multiplayer games.
+    //
+
+    CONFIG_VARIABLE_INT(monster_lod_distance),
+
     //!
     // @game doom strife
     //
@@ -3465,4 +3534,25 @@ char *M_GetAutoloadDir(const char *iwadname, boolean makedir)
     // TODO: Add README file
 
     return result;
-}
\ No newline at end of file
+}
+
+//
+// [AP] Calculate the path to a directory for cached, regenerable data
+// (converted sound effects, level data and so on), with a trailing
+// separator. Creates the directory as necessary.
+//
+char *M_GetCacheDir(const char *subdir)
+{
+    char *topdir, *result;
+
+    topdir = M_StringJoin(configdir, "cache", NULL);
+    M_MakeDirectory(topdir);
+
+    result = M_StringJoin(topdir, DIR_SEPARATOR_S, subdir,
+                          DIR_SEPARATOR_S, NULL);
+    M_MakeDirectory(result);
+
+    free(topdir);
+
+    return result;
+}
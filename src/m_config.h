@@ -37,6 +37,7 @@ float M_GetFloatVariable(const char *name);
 void M_SetConfigFilenames(const char *main_config, const char *extra_config);
 char *M_GetSaveGameDir(const char *iwadname);
 char *M_GetAutoloadDir(const char *iwadname, boolean makedir);
+char *M_GetCacheDir(const char *subdir); // [AP]
 
 extern const char *configdir;
 
@@ -106,18 +106,37 @@ MEMFILE *mem_fopen_write(void)
 
 size_t mem_fwrite(const void *ptr, size_t size, size_t nmemb, MEMFILE *stream)
 {
-	size_t bytes;
+	void *dest;
 
-	if (stream->mode != MODE_WRITE)
+	dest = mem_fwrite_reserve(stream, size * nmemb);
+
+	if (dest == NULL)
 	{
 		return -1;
 	}
+
+	// Copy into buffer
+	
+	memcpy(dest, ptr, size * nmemb);
+
+	return nmemb;
+}
+
+// Make room for the given number of bytes at the current position,
+// advance past them and return a pointer for the caller to fill in.
+
+void *mem_fwrite_reserve(MEMFILE *stream, size_t bytes)
+{
+	unsigned char *result;
+
+	if (stream->mode != MODE_WRITE)
+	{
+		return NULL;
+	}
 	
 	// More bytes than can fit in the buffer?
 	// If so, reallocate bigger.
 
-	bytes = size * nmemb;
-	
 	while (bytes > stream->alloced - stream->position)
 	{
 		unsigned char *newbuf;
@@ -129,15 +148,32 @@ size_t mem_fwrite(const void *ptr, size_t size, size_t nmemb, MEMFILE *stream)
 		stream->alloced *= 2;
 	}
 
-	// Copy into buffer
-	
-	memcpy(stream->buf + stream->position, ptr, bytes);
+	result = stream->buf + stream->position;
 	stream->position += bytes;
 
 	if (stream->position > stream->buflen)
 		stream->buflen = stream->position;
 
-	return nmemb;
+	return result;
+}
+
+// Return a pointer to the next bytes of a read stream and advance past
+// them, or NULL if fewer than that are left.
+
+const void *mem_fread_ptr(MEMFILE *stream, size_t bytes)
+{
+	const unsigned char *result;
+
+	if (stream->mode != MODE_READ
+	 || bytes > stream->buflen - stream->position)
+	{
+		return NULL;
+	}
+
+	result = stream->buf + stream->position;
+	stream->position += bytes;
+
+	return result;
 }
 
 int mem_fputs(const char *str, MEMFILE *stream)
@@ -150,6 +186,33 @@ int mem_fputs(const char *str, MEMFILE *stream)
 	return mem_fwrite(str, sizeof(char), strlen(str), stream);
 }
 
+// Read a line, including the newline, like fgets()
+
+char *mem_fgets(char *str, int count, MEMFILE *stream)
+{
+	int i;
+
+	if (stream->mode != MODE_READ || count <= 0
+	 || stream->position >= stream->buflen)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < count - 1 && stream->position < stream->buflen; )
+	{
+		str[i] = stream->buf[stream->position++];
+
+		if (str[i++] == '\n')
+		{
+			break;
+		}
+	}
+
+	str[i] = '\0';
+
+	return str;
+}
+
 void mem_get_buf(MEMFILE *stream, void **buf, size_t *buflen)
 {
 	*buf = stream->buf;
@@ -29,7 +29,10 @@ MEMFILE *mem_fopen_read(void *buf, size_t buflen);
 size_t mem_fread(void *buf, size_t size, size_t nmemb, MEMFILE *stream);
 MEMFILE *mem_fopen_write(void);
 size_t mem_fwrite(const void *ptr, size_t size, size_t nmemb, MEMFILE *stream);
+void *mem_fwrite_reserve(MEMFILE *stream, size_t bytes);
+const void *mem_fread_ptr(MEMFILE *stream, size_t bytes);
 int mem_fputs(const char *str, MEMFILE *stream);
+char *mem_fgets(char *str, int count, MEMFILE *stream);
 void mem_get_buf(MEMFILE *stream, void **buf, size_t *buflen);
 void mem_fclose(MEMFILE *stream);
 long mem_ftell(MEMFILE *stream);
@@ -16,6 +16,8 @@
 //	Disk load indicator.
 //
 
+#include "SDL.h"
+
 #include "doomtype.h"
 #include "deh_str.h"
 #include "i_swap.h"
@@ -44,7 +46,9 @@ static int loading_disk_xoffs = 0;
 static int loading_disk_yoffs = 0;
 
 // Number of bytes read since the last call to V_DrawDiskIcon().
-static size_t recent_bytes_read = 0;
+// [AP] Atomic, as lumps may be read on the tic thread while the main
+// thread is drawing the icon.
+static SDL_atomic_t recent_bytes_read;
 static boolean disk_drawn;
 
 static void CopyRegion(pixel_t *dest, int dest_pitch,
@@ -116,7 +120,7 @@ void V_EnableLoadingDisk(const char *lump_name, int xoffs, int yoffs)
 
 void V_BeginRead(size_t nbytes)
 {
-    recent_bytes_read += nbytes;
+    SDL_AtomicAdd(&recent_bytes_read, (int) nbytes);
 }
 
 static pixel_t *DiskRegionPointer(void)
@@ -128,7 +132,9 @@ static pixel_t *DiskRegionPointer(void)
 
 void V_DrawDiskIcon(void)
 {
-    if (disk_data != NULL && recent_bytes_read > diskicon_threshold)
+    int bytes_read = SDL_AtomicSet(&recent_bytes_read, 0);
+
+    if (disk_data != NULL && bytes_read > diskicon_threshold)
     {
         // Save the background behind the disk before we draw it.
         CopyRegion(saved_background, LOADING_DISK_W,
@@ -141,8 +147,6 @@ void V_DrawDiskIcon(void)
                    LOADING_DISK_W, LOADING_DISK_H);
         disk_drawn = true;
     }
-
-    recent_bytes_read = 0;
 }
 
 void V_RestoreDiskBackground(void)
@@ -46,6 +46,7 @@
 // Location of each lump on disk.
 lumpinfo_t **lumpinfo;
 unsigned int numlumps = 0;
+unsigned int lumpreloads = 0; // [AP]
 
 // Hash table for fast lookups
 static lumpindex_t *lumphash;
@@ -227,6 +228,7 @@ wad_file_t *W_AddFile (const char *filename)
         lump_p->position = LONG(filerover->filepos);
         lump_p->size = LONG(filerover->size);
         lump_p->cache = NULL;
+        lump_p->wascached = false; // [AP]
         strncpy(lump_p->name, filerover->name, 8);
         ap_do_remap(lump_p->name);
         lumpinfo[i] = lump_p;
@@ -440,6 +442,7 @@ void *W_CacheLumpNum(lumpindex_t lumpnum, int tag)
 
         result = lump->cache;
         Z_ChangeTag(lump->cache, tag);
+        Z_Touch(lump->cache); // [AP]
     }
     else
     {
@@ -448,6 +451,13 @@ void *W_CacheLumpNum(lumpindex_t lumpnum, int tag)
         lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
 	W_ReadLump (lumpnum, lump->cache);
         result = lump->cache;
+
+        // [AP]
+        if (lump->wascached)
+        {
+            ++lumpreloads;
+        }
+        lump->wascached = true;
     }
 	
     return result;
@@ -715,12 +725,19 @@ void *W_CacheLumpNumSafe(lumpindex_t lumpnum)
     else if (lump->cache != NULL)
     {
         result = lump->cache; // Already cached
+        Z_Touch(lump->cache);
     }
     else
     {
         lump->cache = Z_Malloc(W_LumpLength(lumpnum), PU_CACHE, &lump->cache);
         W_ReadLump (lumpnum, lump->cache);
         result = lump->cache;
+
+        if (lump->wascached)
+        {
+            ++lumpreloads;
+        }
+        lump->wascached = true;
     }
     
     return result;
@@ -60,6 +60,7 @@ struct lumpinfo_s
     int		position;
     int		size;
     void       *cache;
+    boolean     wascached; // [AP] read into the cache before
 
     // Used for hash table lookups
     lumpindex_t next;
@@ -69,6 +70,9 @@ struct lumpinfo_s
 extern lumpinfo_t **lumpinfo;
 extern unsigned int numlumps;
 
+// [AP] Lumps read again because their cached copy had been purged.
+extern unsigned int lumpreloads;
+
 wad_file_t *W_AddFile(const char *filename);
 void W_Reload(void);
 
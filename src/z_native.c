@@ -487,6 +487,16 @@ void Z_ChangeUser(void *ptr, void **user)
     *user = ptr;
 }
 
+// [AP] Blocks are purged in the order they were allocated here.
+
+void Z_Touch(void *ptr)
+{
+}
+
+void Z_NextCacheFrame(void)
+{
+}
+
 
 //
 // Z_FreeMemory
@@ -504,3 +514,21 @@ unsigned int Z_ZoneSize(void)
     return 0;
 }
 
+// [AP] There are no arenas here; only the per-tag usage is known.
+
+void Z_GetStats(zonestats_t *stats)
+{
+    memblock_t *block;
+    int i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (i = 0; i < PU_NUM_TAGS; ++i)
+    {
+        for (block = allocated_blocks[i]; block != NULL; block = block->next)
+        {
+            stats->tagbytes[i] += block->size;
+        }
+    }
+}
+
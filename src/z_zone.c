@@ -16,6 +16,8 @@
 //	Zone Memory Allocation. Neat.
 //
 
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "doomtype.h"
@@ -42,6 +44,7 @@
 typedef struct memblock_s
 {
     int			size;	// including the header and possibly tiny fragments
+    unsigned int	stamp;	// [AP] cache frame of the last use
     void**		user;
     int			tag;	// PU_FREE if this is free
     int			id;	// should be ZONEID
@@ -50,7 +53,7 @@ typedef struct memblock_s
 } memblock_t;
 
 
-typedef struct
+typedef struct memzone_s
 {
     // total bytes malloced, including header
     int		size;
@@ -59,15 +62,85 @@ typedef struct
     memblock_t	blocklist;
     
     memblock_t*	rover;
+
+    // [AP] next arena in the chain
+    struct memzone_s*	next;
     
 } memzone_t;
 
 
+// [AP] The zone is a chain of arenas. The first one comes from
+// I_ZoneBase() and is kept for the whole run; more are added when an
+// allocation does not fit anywhere, and released again by Z_FreeTags
+// once nothing but purgable blocks is left in them. Up to
+// ZONE_GROWTH_LIMIT times the initial size, growing is preferred over
+// purging PU_CACHE data; past it, the least recently used purgable
+// blocks are thrown out first (see EvictForBlock). A size given with
+// -mb is a hard limit: the zone never grows past it.
+
+#define ZONE_GROWTH_LIMIT 8
 
+static memzone_t *zones;
+static boolean zone_fixed;
+
+// The arena allocations currently start in.
 static memzone_t *mainzone;
+
+static zonestats_t zonestats;
+
+// [AP] Advanced by Z_NextCacheFrame; blocks are stamped with it when
+// they are allocated and whenever Z_Touch is called on them.
+static unsigned int cacheframe;
+
+// [AP] Scratch space for EvictForBlock.
+static memblock_t **evictqueue;
+static int evictqueuesize;
 static boolean zero_on_free;
 static boolean scan_on_free;
 
+//
+// [AP] SLAB POOLS
+//
+// Small PU_LEVEL and PU_LEVSPEC allocations without an owner (mobjs,
+// floor/ceiling/door/plat thinkers and the like) are carved out of
+// fixed-size slabs instead of the block list. Allocating and freeing one
+// is a free list push or pop. Each object carries a regular memblock_t
+// header (id SLABID, prev pointing at its chunk), so Z_Free, Z_ChangeTag
+// and Z_ChangeUser work on them unchanged. The chunks themselves are
+// ordinary PU_STATIC zone blocks; Z_FreeTags frees the objects in its
+// tag range and returns chunks that end up empty to the zone.
+//
+
+#define SLABID		0x51ab11
+#define SLAB_CHUNK_SIZE	(64 * 1024)
+
+typedef struct slabpool_s slabpool_t;
+
+typedef struct slabchunk_s
+{
+    struct slabchunk_s*	next;
+    slabpool_t*		pool;
+    int			live;	// objects allocated from this chunk
+} slabchunk_t;
+
+struct slabpool_s
+{
+    int			size;	// object size, without the header
+    int			tag;
+    memblock_t*		freelist;
+    slabchunk_t*	chunks;
+};
+
+static const int slab_sizes[] = { 32, 64, 96, 128, 192, 256, 384, 512 };
+
+#define NUM_SLAB_SIZES	arrlen(slab_sizes)
+#define MAX_SLAB_SIZE	512
+
+// One pool per size class for each of PU_LEVEL and PU_LEVSPEC.
+static slabpool_t slabpools[2][NUM_SLAB_SIZES];
+
+static void ScanForBlock(void *start, void *end);
+
 
 //
 // Z_ClearZone
@@ -102,9 +175,12 @@ void Z_Init (void)
 {
     memblock_t*	block;
     int		size;
+    int		i, j;
 
     mainzone = (memzone_t *)I_ZoneBase (&size);
     mainzone->size = size;
+    mainzone->next = NULL;
+    zones = mainzone;
 
     // set the entire zone to one free block
     mainzone->blocklist.next =
@@ -133,19 +209,211 @@ void Z_Init (void)
     // heap is scanned to look for remaining pointers to the freed block.
     //
     scan_on_free = M_ParmExists("-zonescan");
+
+    zone_fixed = M_ParmExists("-mb");
+
+    // [AP] Disable the slab pools and allocate everything from the block
+    // list, as vanilla does.
+    //
+    if (M_ParmExists("-noslabs"))
+    {
+        memset(slabpools, 0, sizeof(slabpools));
+        return;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < NUM_SLAB_SIZES; j++)
+        {
+            slabpools[i][j].size = slab_sizes[j];
+            slabpools[i][j].tag = i == 0 ? PU_LEVEL : PU_LEVSPEC;
+        }
+    }
+}
+
+static slabpool_t *SlabPoolFor(int size, int tag)
+{
+    int i;
+
+    if (size > MAX_SLAB_SIZE || (tag != PU_LEVEL && tag != PU_LEVSPEC))
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < NUM_SLAB_SIZES; i++)
+    {
+        if (size <= slab_sizes[i])
+        {
+            break;
+        }
+    }
+
+    if (slabpools[tag == PU_LEVSPEC][i].size == 0)
+    {
+        return NULL;
+    }
+
+    return &slabpools[tag == PU_LEVSPEC][i];
+}
+
+#define SlabStride(pool) ((int) sizeof(memblock_t) + (pool)->size)
+#define SlabObjects(pool) \
+    ((SLAB_CHUNK_SIZE - (int) sizeof(slabchunk_t)) / SlabStride(pool))
+#define SlabObject(chunk, pool, i) \
+    ((memblock_t *) ((byte *) ((chunk) + 1) + (i) * SlabStride(pool)))
+
+static void SlabGrow(slabpool_t *pool)
+{
+    slabchunk_t *chunk;
+    memblock_t *block;
+    int i;
+
+    chunk = Z_Malloc(SLAB_CHUNK_SIZE, PU_STATIC, NULL);
+    chunk->next = pool->chunks;
+    chunk->pool = pool;
+    chunk->live = 0;
+    pool->chunks = chunk;
+
+    for (i = SlabObjects(pool) - 1; i >= 0; i--)
+    {
+        block = SlabObject(chunk, pool, i);
+        block->size = SlabStride(pool);
+        block->user = NULL;
+        block->tag = PU_FREE;
+        block->id = 0;
+        block->prev = (memblock_t *) chunk;
+        block->next = pool->freelist;
+        pool->freelist = block;
+    }
+}
+
+static void *SlabMalloc(slabpool_t *pool)
+{
+    memblock_t *block;
+
+    if (pool->freelist == NULL)
+    {
+        SlabGrow(pool);
+    }
+
+    block = pool->freelist;
+    pool->freelist = block->next;
+    block->next = NULL;
+    block->tag = pool->tag;
+    block->id = SLABID;
+    ++((slabchunk_t *) block->prev)->live;
+    zonestats.slabbytes += pool->size;
+
+    return (byte *) block + sizeof(memblock_t);
+}
+
+static void SlabFree(memblock_t *block)
+{
+    slabchunk_t *chunk = (slabchunk_t *) block->prev;
+    slabpool_t *pool = chunk->pool;
+    void *ptr = (byte *) block + sizeof(memblock_t);
+
+    if (block->user != NULL)
+    {
+        *block->user = 0;
+    }
+
+    block->tag = PU_FREE;
+    block->user = NULL;
+    block->id = 0;
+
+    if (zero_on_free)
+    {
+        memset(ptr, 0, pool->size);
+    }
+    if (scan_on_free)
+    {
+        ScanForBlock(ptr, (byte *) ptr + pool->size);
+    }
+
+    --chunk->live;
+    zonestats.slabbytes -= pool->size;
+    block->next = pool->freelist;
+    pool->freelist = block;
+}
+
+// Free every slab object with a tag in the given range, then return the
+// chunks left empty to the zone and rebuild the free lists from the rest.
+
+static void SlabFreeTags(int lowtag, int hightag)
+{
+    slabpool_t *pool;
+    slabchunk_t *chunk, **prev;
+    memblock_t *block;
+    int i, j, n;
+
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < NUM_SLAB_SIZES; j++)
+        {
+            pool = &slabpools[i][j];
+
+            if (pool->chunks == NULL)
+            {
+                continue;
+            }
+
+            for (chunk = pool->chunks; chunk != NULL; chunk = chunk->next)
+            {
+                for (n = 0; n < SlabObjects(pool); n++)
+                {
+                    block = SlabObject(chunk, pool, n);
+
+                    if (block->id == SLABID
+                     && block->tag >= lowtag && block->tag <= hightag)
+                    {
+                        SlabFree(block);
+                    }
+                }
+            }
+
+            pool->freelist = NULL;
+
+            for (prev = &pool->chunks; (chunk = *prev) != NULL; )
+            {
+                if (chunk->live == 0)
+                {
+                    *prev = chunk->next;
+                    Z_Free(chunk);
+                    continue;
+                }
+
+                for (n = SlabObjects(pool) - 1; n >= 0; n--)
+                {
+                    block = SlabObject(chunk, pool, n);
+
+                    if (block->id != SLABID)
+                    {
+                        block->next = pool->freelist;
+                        pool->freelist = block;
+                    }
+                }
+
+                prev = &chunk->next;
+            }
+        }
+    }
 }
 
 // Scan the zone heap for pointers within the specified range, and warn about
 // any remaining pointers.
 static void ScanForBlock(void *start, void *end)
 {
+    memzone_t *zone;
     memblock_t *block;
     void **mem;
     int i, len, tag;
 
-    block = mainzone->blocklist.next;
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+    block = zone->blocklist.next;
 
-    while (block->next != &mainzone->blocklist)
+    while (block->next != &zone->blocklist)
     {
         tag = block->tag;
 
@@ -170,6 +438,26 @@ static void ScanForBlock(void *start, void *end)
 
         block = block->next;
     }
+    }
+}
+
+// [AP] Find the arena a block lives in.
+
+static memzone_t *ZoneForBlock(memblock_t *block)
+{
+    memzone_t *zone;
+
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+        if ((byte *) block > (byte *) zone
+         && (byte *) block < (byte *) zone + zone->size)
+        {
+            return zone;
+        }
+    }
+
+    I_Error("Z_Free: block %p is not in any zone arena", block);
+    return NULL;
 }
 
 //
@@ -179,9 +467,17 @@ void Z_Free (void* ptr)
 {
     memblock_t*		block;
     memblock_t*		other;
+    memzone_t*		zone;
 
     block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 
+    // [AP]
+    if (block->id == SLABID)
+    {
+        SlabFree(block);
+        return;
+    }
+
     if (block->id != ZONEID)
 	I_Error ("Z_Free: freed a pointer without ZONEID");
 
@@ -208,6 +504,8 @@ void Z_Free (void* ptr)
                      (byte *) ptr + block->size - sizeof(memblock_t));
     }
 
+    zone = ZoneForBlock(block); // [AP]
+
     other = block->prev;
 
     if (other->tag == PU_FREE)
@@ -217,8 +515,8 @@ void Z_Free (void* ptr)
         other->next = block->next;
         other->next->prev = other;
 
-        if (block == mainzone->rover)
-            mainzone->rover = other;
+        if (block == zone->rover)
+            zone->rover = other;
 
         block = other;
     }
@@ -231,8 +529,8 @@ void Z_Free (void* ptr)
         block->next = other->next;
         block->next->prev = block;
 
-        if (other == mainzone->rover)
-            mainzone->rover = block;
+        if (other == zone->rover)
+            zone->rover = block;
     }
 }
 
@@ -244,33 +542,20 @@ void Z_Free (void* ptr)
 //
 #define MINFRAGMENT		64
 
+// [AP] Look for a free block of at least size bytes (header included) in
+// one arena, starting at its rover. Purgable blocks are skipped, like
+// any other that is in use. Returns NULL once the whole arena has been
+// scanned.
 
-void*
-Z_Malloc
-( int		size,
-  int		tag,
-  void*		user )
+static memblock_t *FindBlock(memzone_t *zone, int size)
 {
-    int		extra;
     memblock_t*	start;
     memblock_t* rover;
-    memblock_t* newblock;
     memblock_t*	base;
-    void *result;
 
-    size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
-    
-    // scan through the block list,
-    // looking for the first free block
-    // of sufficient size,
-    // throwing out any purgable blocks along the way.
-
-    // account for size of block header
-    size += sizeof(memblock_t);
-    
     // if there is a free block behind the rover,
     //  back up over them
-    base = mainzone->rover;
+    base = zone->rover;
     
     if (base->prev->tag == PU_FREE)
         base = base->prev;
@@ -283,42 +568,323 @@ Z_Malloc
         if (rover == start)
         {
             // scanned all the way around the list
-//          I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
-
-            // [crispy] allocate another zone twice as big
-            Z_Init();
-
-            base = mainzone->rover;
-            rover = base;
-            start = base->prev;
+            return NULL;
         }
 	
         if (rover->tag != PU_FREE)
         {
-            if (rover->tag < PU_PURGELEVEL)
+            // hit a block that is in use,
+            // so move base past it
+            base = rover = rover->next;
+        }
+        else
+        {
+            rover = rover->next;
+        }
+
+    } while (base->tag != PU_FREE || base->size < size);
+
+    return base;
+}
+
+static memblock_t *FindBlockInArenas(int size)
+{
+    memzone_t *zone;
+    memblock_t *base;
+
+    zone = mainzone;
+
+    do
+    {
+        base = FindBlock(zone, size);
+
+        if (base != NULL)
+        {
+            mainzone = zone;
+            return base;
+        }
+
+        zone = zone->next != NULL ? zone->next : zones;
+    } while (zone != mainzone);
+
+    return NULL;
+}
+
+//
+// [AP] PU_CACHE EVICTION
+//
+// Vanilla purges whatever purgable blocks follow the rover, which may
+// well be the textures and sounds the next frame needs. Instead, every
+// run of adjacent free and purgable blocks that is big enough for the
+// allocation is considered, and the one whose most recently used block
+// was used the longest ago is purged; of those equally old, the one
+// that purges the fewest bytes. The shortest run ending at each block
+// is the best one ending there, so one pass over each arena, keeping
+// the stamps of the run in a monotonic queue, finds it.
+//
+// That pass is as slow as a full scan of the zone, so runs of at least
+// EVICT_MIN_SIZE bytes are preferred; the space left over after the
+// allocation sits right at the rover, for the next few to use.
+//
+
+#define EVICT_MIN_SIZE (64 * 1024)
+
+#define Purgable(block) ((block)->tag >= PU_PURGELEVEL)
+#define BlockAge(block) (cacheframe - (block)->stamp)
+
+typedef struct
+{
+    memzone_t*		zone;
+    memblock_t*		first;
+    unsigned int	age;	// of the most recently used block
+    int			purged;	// bytes of purgable blocks
+} evictrun_t;
+
+static void BestRunInArena(memzone_t *zone, int size, evictrun_t *best)
+{
+    memblock_t *first, *last;
+    unsigned int age;
+    int total, purged;
+    int head, tail;
+
+    first = zone->blocklist.next;
+    total = purged = 0;
+    head = tail = 0;
+
+    for (last = first; last != &zone->blocklist; last = last->next)
+    {
+        if (last->tag != PU_FREE && !Purgable(last))
+        {
+            // in use, so no run can span it
+            first = last->next;
+            total = purged = 0;
+            head = tail = 0;
+            continue;
+        }
+
+        total += last->size;
+
+        if (Purgable(last))
+        {
+            purged += last->size;
+
+            // blocks at least as old as this one leave the run before
+            // it, so they can no longer be its most recently used
+            while (tail > head && BlockAge(evictqueue[tail - 1])
+                                  >= BlockAge(last))
             {
-                // hit a block that can't be purged,
-                // so move base past it
-                base = rover = rover->next;
+                --tail;
             }
-            else
+
+            if (tail == evictqueuesize && head > 0)
             {
-                // free the rover block (adding the size to base)
+                memmove(evictqueue, evictqueue + head,
+                        (tail - head) * sizeof(*evictqueue));
+                tail -= head;
+                head = 0;
+            }
 
-                // the rover can be the base block
-                base = base->prev;
-                Z_Free ((byte *)rover+sizeof(memblock_t));
-                base = base->next;
-                rover = base->next;
+            if (tail == evictqueuesize)
+            {
+                evictqueuesize = evictqueuesize ? evictqueuesize * 2 : 256;
+                evictqueue = I_Realloc(evictqueue,
+                                       evictqueuesize * sizeof(*evictqueue));
             }
+
+            evictqueue[tail++] = last;
         }
-        else
+
+        // drop blocks from the front while the run still fits
+        while (total - first->size >= size)
         {
-            rover = rover->next;
+            total -= first->size;
+
+            if (Purgable(first))
+            {
+                purged -= first->size;
+
+                if (head < tail && evictqueue[head] == first)
+                {
+                    ++head;
+                }
+            }
+
+            first = first->next;
         }
 
-    } while (base->tag != PU_FREE || base->size < size);
+        if (total < size)
+        {
+            continue;
+        }
+
+        age = tail > head ? BlockAge(evictqueue[head]) : UINT_MAX;
+
+        if (best->zone == NULL || age > best->age
+         || (age == best->age && purged < best->purged))
+        {
+            best->zone = zone;
+            best->first = first;
+            best->age = age;
+            best->purged = purged;
+        }
+    }
+}
+
+// Purge the best run in any arena, and return the free block it leaves.
+// NULL if no run is big enough.
+
+static memblock_t *EvictForBlock(int size)
+{
+    evictrun_t best;
+    memzone_t *zone;
+    memblock_t *block, *prev;
+
+    best.zone = NULL;
+
+    if (size < EVICT_MIN_SIZE)
+    {
+        for (zone = zones; zone != NULL; zone = zone->next)
+        {
+            BestRunInArena(zone, EVICT_MIN_SIZE, &best);
+        }
+
+        if (best.zone != NULL)
+        {
+            size = EVICT_MIN_SIZE;
+        }
+    }
+
+    if (best.zone == NULL)
+    {
+        for (zone = zones; zone != NULL; zone = zone->next)
+        {
+            BestRunInArena(zone, size, &best);
+        }
+    }
+
+    if (best.zone == NULL)
+    {
+        return NULL;
+    }
+
+    block = best.first;
+
+    for (;;)
+    {
+        if (block->tag == PU_FREE)
+        {
+            if (block->size >= size)
+            {
+                break;
+            }
+
+            block = block->next;
+            continue;
+        }
+
+        // the freed block may be merged into the one before it
+        prev = block->prev;
+        Z_Free((byte *) block + sizeof(memblock_t));
+        ++zonestats.purges;
+
+        if (prev->tag == PU_FREE)
+        {
+            block = prev;
+        }
+    }
+
+    mainzone = best.zone;
+
+    return block;
+}
+
+// [AP] Add an arena big enough for at least one block of size bytes.
+
+static memblock_t *NewArena(int size)
+{
+    memzone_t *zone, **last;
+    memblock_t *block;
+    int arenasize;
+
+    arenasize = zones->size;
+
+    if (arenasize < size + (int) sizeof(memzone_t))
+    {
+        arenasize = size + sizeof(memzone_t);
+    }
+
+    zone = malloc(arenasize);
+
+    if (zone == NULL)
+    {
+        I_Error("Z_Malloc: failed on allocation of %i bytes", size);
+    }
+
+    zone->size = arenasize;
+    zone->next = NULL;
+    Z_ClearZone(zone);
+
+    block = zone->rover;
+    block->user = NULL;
+
+    for (last = &zones; *last != NULL; last = &(*last)->next);
+    *last = zone;
+
+    mainzone = zone;
+    ++zonestats.arenagrows;
+
+    return block;
+}
+
+void*
+Z_Malloc
+( int		size,
+  int		tag,
+  void*		user )
+{
+    int		extra;
+    memblock_t* newblock;
+    memblock_t*	base;
+    slabpool_t*	pool;
+    void *result;
+
+    size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
+
+    // [AP] small owner-less level objects come from the slab pools
+    if (user == NULL && (pool = SlabPoolFor(size, tag)) != NULL)
+    {
+        return SlabMalloc(pool);
+    }
+    
+    // scan through the block list,
+    // looking for the first free block
+    // of sufficient size.
 
+    // account for size of block header
+    size += sizeof(memblock_t);
+
+    // [AP] Free space in any arena first. Below the growth limit a new
+    // arena is cheaper than throwing out cached data, past it purging
+    // comes first; and if even that fails, grow anyway, unless -mb
+    // fixed the size of the zone.
+    base = FindBlockInArenas(size);
+
+    if (base == NULL
+     && (zone_fixed
+      || Z_ZoneSize() >= (unsigned int) zones->size * ZONE_GROWTH_LIMIT))
+    {
+        base = EvictForBlock(size);
+    }
+
+    if (base == NULL)
+    {
+        if (zone_fixed)
+        {
+            I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+        }
+
+        base = NewArena(size);
+    }
     
     // found a block big enough
     extra = base->size - size;
@@ -344,6 +910,7 @@ Z_Malloc
 
     base->user = user;
     base->tag = tag;
+    base->stamp = cacheframe; // [AP]
 
     result  = (void *) ((byte *)base + sizeof(memblock_t));
 
@@ -360,7 +927,50 @@ Z_Malloc
     return result;
 }
 
+// [AP] Give an arena other than the first back to the system if it only
+// holds purgable blocks, purging them.
 
+static boolean ReleaseArena(memzone_t *zone)
+{
+    memzone_t **link;
+    memblock_t *block, *next;
+
+    for (block = zone->blocklist.next;
+         block != &zone->blocklist;
+         block = block->next)
+    {
+        if (block->tag != PU_FREE && block->tag < PU_PURGELEVEL)
+        {
+            return false;
+        }
+    }
+
+    for (block = zone->blocklist.next;
+         block != &zone->blocklist;
+         block = next)
+    {
+        next = block->next;
+
+        if (block->tag != PU_FREE)
+        {
+            Z_Free((byte *) block + sizeof(memblock_t));
+            ++zonestats.purges;
+        }
+    }
+
+    for (link = &zones; *link != zone; link = &(*link)->next);
+    *link = zone->next;
+
+    if (mainzone == zone)
+    {
+        mainzone = zones;
+    }
+
+    free(zone);
+    ++zonestats.arenareleases;
+
+    return true;
+}
 
 //
 // Z_FreeTags
@@ -370,11 +980,17 @@ Z_FreeTags
 ( int		lowtag,
   int		hightag )
 {
+    memzone_t*	zone;
+    memzone_t*	nextzone;
     memblock_t*	block;
     memblock_t*	next;
+
+    SlabFreeTags(lowtag, hightag); // [AP]
 	
-    for (block = mainzone->blocklist.next ;
-	 block != &mainzone->blocklist ;
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+    for (block = zone->blocklist.next ;
+	 block != &zone->blocklist ;
 	 block = next)
     {
 	// get link before freeing
@@ -387,6 +1003,14 @@ Z_FreeTags
 	if (block->tag >= lowtag && block->tag <= hightag)
 	    Z_Free ( (byte *)block+sizeof(memblock_t));
     }
+    }
+
+    // [AP] the first arena always stays
+    for (zone = zones->next; zone != NULL; zone = nextzone)
+    {
+        nextzone = zone->next;
+        ReleaseArena(zone);
+    }
 }
 
 
@@ -400,21 +1024,24 @@ Z_DumpHeap
 ( int		lowtag,
   int		hightag )
 {
+    memzone_t*	zone;
     memblock_t*	block;
 	
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
     printf ("zone size: %i  location: %p\n",
-	    mainzone->size,mainzone);
+	    zone->size,zone);
     
     printf ("tag range: %i to %i\n",
 	    lowtag, hightag);
 	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+    for (block = zone->blocklist.next ; ; block = block->next)
     {
 	if (block->tag >= lowtag && block->tag <= hightag)
 	    printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
 		    block, block->size, block->user, block->tag);
 		
-	if (block->next == &mainzone->blocklist)
+	if (block->next == &zone->blocklist)
 	{
 	    // all blocks have been hit
 	    break;
@@ -429,6 +1056,7 @@ Z_DumpHeap
 	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
 	    printf ("ERROR: two consecutive free blocks\n");
     }
+    }
 }
 
 
@@ -437,16 +1065,19 @@ Z_DumpHeap
 //
 void Z_FileDumpHeap (FILE* f)
 {
+    memzone_t*	zone;
     memblock_t*	block;
 	
-    fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+    fprintf (f,"zone size: %i  location: %p\n",zone->size,zone);
 	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+    for (block = zone->blocklist.next ; ; block = block->next)
     {
 	fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
 		 block, block->size, block->user, block->tag);
 		
-	if (block->next == &mainzone->blocklist)
+	if (block->next == &zone->blocklist)
 	{
 	    // all blocks have been hit
 	    break;
@@ -461,6 +1092,7 @@ void Z_FileDumpHeap (FILE* f)
 	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
 	    fprintf (f,"ERROR: two consecutive free blocks\n");
     }
+    }
 }
 
 
@@ -470,11 +1102,14 @@ void Z_FileDumpHeap (FILE* f)
 //
 void Z_CheckHeap (void)
 {
+    memzone_t*	zone;
     memblock_t*	block;
 	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+    for (block = zone->blocklist.next ; ; block = block->next)
     {
-	if (block->next == &mainzone->blocklist)
+	if (block->next == &zone->blocklist)
 	{
 	    // all blocks have been hit
 	    break;
@@ -489,6 +1124,7 @@ void Z_CheckHeap (void)
 	if (block->tag == PU_FREE && block->next->tag == PU_FREE)
 	    I_Error ("Z_CheckHeap: two consecutive free blocks\n");
     }
+    }
 }
 
 
@@ -503,7 +1139,7 @@ void Z_ChangeTag2(void *ptr, int tag, const char *file, int line)
 	
     block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
 
-    if (block->id != ZONEID)
+    if (block->id != ZONEID && block->id != SLABID) // [AP]
         I_Error("%s:%i: Z_ChangeTag: block without a ZONEID!",
                 file, line);
 
@@ -514,13 +1150,27 @@ void Z_ChangeTag2(void *ptr, int tag, const char *file, int line)
     block->tag = tag;
 }
 
+// [AP]
+void Z_Touch(void *ptr)
+{
+    memblock_t*	block;
+
+    block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
+    block->stamp = cacheframe;
+}
+
+void Z_NextCacheFrame(void)
+{
+    ++cacheframe;
+}
+
 void Z_ChangeUser(void *ptr, void **user)
 {
     memblock_t*	block;
 
     block = (memblock_t *) ((byte *)ptr - sizeof(memblock_t));
 
-    if (block->id != ZONEID)
+    if (block->id != ZONEID && block->id != SLABID) // [AP]
     {
         I_Error("Z_ChangeUser: Tried to change user for invalid block!");
     }
@@ -536,24 +1186,70 @@ void Z_ChangeUser(void *ptr, void **user)
 //
 int Z_FreeMemory (void)
 {
+    memzone_t*		zone;
     memblock_t*		block;
     int			free;
 	
     free = 0;
     
-    for (block = mainzone->blocklist.next ;
-         block != &mainzone->blocklist;
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+    for (block = zone->blocklist.next ;
+         block != &zone->blocklist;
          block = block->next)
     {
         if (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL)
             free += block->size;
     }
+    }
 
     return free;
 }
 
 unsigned int Z_ZoneSize(void)
 {
-    return mainzone->size;
+    memzone_t *zone;
+    unsigned int size = 0;
+
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+        size += zone->size;
+    }
+
+    return size;
+}
+
+//
+// Z_GetStats
+//
+void Z_GetStats(zonestats_t *stats)
+{
+    memzone_t *zone;
+    memblock_t *block;
+
+    *stats = zonestats;
+
+    for (zone = zones; zone != NULL; zone = zone->next)
+    {
+        ++stats->arenas;
+        stats->zonesize += zone->size;
+
+        for (block = zone->blocklist.next;
+             block != &zone->blocklist;
+             block = block->next)
+        {
+            stats->tagbytes[block->tag] += block->size;
+
+            if (block->tag == PU_FREE)
+            {
+                ++stats->freeblocks;
+
+                if ((unsigned int) block->size > stats->largestfree)
+                {
+                    stats->largestfree = block->size;
+                }
+            }
+        }
+    }
 }
 
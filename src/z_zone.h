@@ -59,9 +59,32 @@ void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag, const char *file, int line);
 void    Z_ChangeUser(void *ptr, void **user);
+
+// [AP] Mark a block as used in the current cache frame. When purgable
+// blocks have to be thrown out, those least recently used go first.
+void    Z_Touch(void *ptr);
+void    Z_NextCacheFrame(void);
 int     Z_FreeMemory (void);
 unsigned int Z_ZoneSize(void);
 
+// [AP] Zone statistics, as returned by Z_GetStats.
+typedef struct
+{
+    int arenas;
+    unsigned int zonesize;              // all arenas, in bytes
+    unsigned int tagbytes[PU_NUM_TAGS]; // per tag, headers included;
+                                        // PU_FREE is the free space
+    unsigned int largestfree;
+    int freeblocks;
+    unsigned int slabbytes;             // live slab objects, counted
+                                        // as PU_STATIC in tagbytes
+    unsigned int purges;                // purgable blocks thrown out
+    int arenagrows;
+    int arenareleases;
+} zonestats_t;
+
+void    Z_GetStats(zonestats_t *stats);
+
 //
 // This is used to get the local FILE:LINE info from CPP
 // prior to really call the function in question.